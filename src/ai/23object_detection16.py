@@ -5,6 +5,7 @@ from picamera2 import Picamera2
 from ai_edge_litert.interpreter import Interpreter
 import RPi.GPIO as GPIO
 import time
+import argparse
 
 # =========================
 # 서보 설정 (GPIO18 사용)
@@ -32,32 +33,84 @@ picam2.preview_configuration.main.format = "RGB888"
 picam2.configure("preview")
 picam2.start()
 
+SOLDIER_CLASS_ID = 1  # 0: person, 1: soldier
+
 # =========================
-# TFLite Interpreter 초기화
-# (FP16 모델이지만 입출력은 float32)
+# TFLite 검출기
+# - FP16 모델: 입출력 float32 → 0~1 정규화 후 set_tensor
+# - 양자화 모델(uint8/int8 입력): 카메라 프레임을 입력 텐서 메모리에 바로 기록
+#   (float 변환/중간 버퍼 없음, 카메라가 이미 224x224 RGB888이면 resize도 생략)
 # =========================
-# model.tflite <- best-fp16.tflite 복사해서 이름 맞춰두기
-#interpreter = tflite.Interpreter(model_path="model.tflite", num_threads=4)
-interpreter = Interpreter(model_path="model.tflite")
-interpreter.allocate_tensors()
-
-inp = interpreter.get_input_details()[0]
-out = interpreter.get_output_details()[0]
-
-in_shape = inp["shape"]
-print("input shape:", in_shape, "dtype:", inp["dtype"])
-_, H, W, C = in_shape
-assert C == 3, f"Expected 3-channel input, got {C}"
-
-# FP16 TFLite는 보통 float32 입력을 받음
-inp_buf = np.empty((1, H, W, C), dtype=np.float32)
-
-# 전처리: HWC uint8 → HWC float32(0~1)
-def preprocess(frame_rgb):
-    frame_resized = cv2.resize(frame_rgb, (W, H))
-    frame_f32 = frame_resized.astype(np.float32) / 255.0
-    inp_buf[0] = frame_f32
-    return inp_buf
+# model.tflite <- best-fp16.tflite 또는 best-int8.tflite 복사해서 이름 맞춰두기
+class Detector:
+    def __init__(self, model_path):
+        #self.interpreter = tflite.Interpreter(model_path=model_path, num_threads=4)
+        self.interpreter = Interpreter(model_path=model_path)
+        self.interpreter.allocate_tensors()
+
+        self.inp = self.interpreter.get_input_details()[0]
+        self.out = self.interpreter.get_output_details()[0]
+
+        in_shape = self.inp["shape"]
+        print(f"[{model_path}] input shape:", in_shape, "dtype:", self.inp["dtype"])
+        _, self.H, self.W, C = in_shape
+        assert C == 3, f"Expected 3-channel input, got {C}"
+
+        self.quantized = self.inp["dtype"] in (np.uint8, np.int8)
+
+        if self.quantized:
+            # 픽셀(0~255) → 양자화 값 변환표: q = round(p / 255 / scale) + zero_point
+            scale, zp = self.inp["quantization"]
+            info = np.iinfo(self.inp["dtype"])
+            q = np.round(np.arange(256) / 255.0 / scale) + zp
+            self.in_lut = np.clip(q, info.min, info.max).astype(self.inp["dtype"])
+
+            # 보통(scale=1/255)은 복사 한 번 또는 부호 비트 뒤집기로 끝남
+            if np.array_equal(self.in_lut.view(np.uint8), np.arange(256, dtype=np.uint8)):
+                self.in_mode = "copy"    # uint8, zp=0
+            elif np.array_equal(self.in_lut.view(np.uint8), np.arange(256, dtype=np.uint8) ^ 0x80):
+                self.in_mode = "xor"     # int8, zp=-128
+            else:
+                self.in_mode = "lut"
+        else:
+            self.inp_buf = np.empty((1, self.H, self.W, C), dtype=np.float32)
+
+        # 출력도 양자화돼 있으면 후처리에서 쓰는 열만 역양자화
+        out_scale, out_zp = self.out["quantization"]
+        self.out_quant = (out_scale, out_zp) if self.out["dtype"] in (np.uint8, np.int8) and out_scale > 0 else None
+
+    # 전처리: HWC uint8 → 입력 텐서
+    def preprocess(self, frame_rgb):
+        if frame_rgb.shape[:2] != (self.H, self.W):
+            frame_rgb = cv2.resize(frame_rgb, (self.W, self.H))
+
+        if not self.quantized:
+            # FP16 모델: HWC float32(0~1)
+            self.inp_buf[0] = frame_rgb.astype(np.float32) / 255.0
+            self.interpreter.set_tensor(self.inp["index"], self.inp_buf)
+            return
+
+        # 입력 텐서 내부 버퍼 뷰 (invoke 전에 반드시 놓아야 하므로 붙잡아 두지 않음)
+        t = self.interpreter.tensor(self.inp["index"])()[0]
+        if self.in_mode == "copy":
+            np.copyto(t, frame_rgb)
+        elif self.in_mode == "xor":
+            np.bitwise_xor(frame_rgb, 0x80, out=t.view(np.uint8))
+        else:
+            # uint8 인덱스는 항상 LUT(256) 범위 안: mode="clip"이면 out에 바로 씀 (기본 "raise"는 임시 버퍼를 거침)
+            np.take(self.in_lut, frame_rgb, out=t, mode="clip")
+        del t
+
+    def infer(self, frame_rgb):
+        self.preprocess(frame_rgb)
+        self.interpreter.invoke()
+        pred = self.interpreter.get_tensor(self.out["index"])
+        return pred if self.out_quant else pred.astype(np.float32)
+
+    def detect(self, frame_rgb, conf_thres=0.45, iou_thres=0.45):
+        pred = self.infer(frame_rgb)
+        orig_h, orig_w = frame_rgb.shape[:2]
+        return yolo_postprocess(pred, orig_w, orig_h, conf_thres, iou_thres, self.out_quant)
 
 # ==========================
 # 간단한 NMS 함수 (greedy)
@@ -98,23 +151,29 @@ def nms_xyxy(boxes, scores, iou_thres=0.45):
     return keep
 
 # 후처리: YOLOv5 TFLite 출력 -> (box, score, class)
-def yolo_postprocess(pred, orig_w, orig_h, conf_thres=0.45, iou_thres=0.45):
+# out_quant=(scale, zero_point)이면 pred는 정수 그대로 받음
+def yolo_postprocess(pred, orig_w, orig_h, conf_thres=0.45, iou_thres=0.45, out_quant=None):
     p = pred[0]
     if p.ndim != 2 or p.shape[1] < 6:
         return []
 
-    boxes_xywh = p[:, :4]          # [cx, cy, w, h] (0~1 정규화 가정)
-    obj = p[:, 4]
     cls_probs = p[:, 5:]
-    cls_ids = cls_probs.argmax(axis=1)
+    cls_ids = cls_probs.argmax(axis=1)   # scale > 0 이면 정수 상태로 argmax 해도 같음
     cls_scores = cls_probs.max(axis=1)
+    obj = p[:, 4]
+    if out_quant is not None:
+        scale, zp = out_quant
+        obj = (obj.astype(np.float32) - zp) * scale
+        cls_scores = (cls_scores.astype(np.float32) - zp) * scale
     scores = obj * cls_scores
 
     mask = scores >= conf_thres
     if not np.any(mask):
         return []
 
-    boxes_xywh = boxes_xywh[mask]
+    boxes_xywh = p[mask, :4]       # [cx, cy, w, h] (0~1 정규화 가정)
+    if out_quant is not None:
+        boxes_xywh = (boxes_xywh.astype(np.float32) - zp) * scale
     scores = scores[mask]
     cls_ids = cls_ids[mask]
 
@@ -148,10 +207,9 @@ def yolo_postprocess(pred, orig_w, orig_h, conf_thres=0.45, iou_thres=0.45):
 
     return results
 
-def main():
+def main(det):
     global current_angle, servo_pwm
 
-    SOLDIER_CLASS_ID = 1  # 0: person, 1: soldier
     last_update_time = time.time()
 
     try:
@@ -160,18 +218,8 @@ def main():
             orig_h, orig_w = frame_rgb.shape[:2]
             frame_center_x = orig_w / 2.0
 
-            inp_arr = preprocess(frame_rgb)
-            interpreter.set_tensor(inp["index"], inp_arr)
-            interpreter.invoke()
-
-            prediction = interpreter.get_tensor(out["index"]).astype(np.float32)
-
             # soldier 인식 기준을 약간 빡세게 (conf_thres 0.55)
-            detections = yolo_postprocess(
-                prediction, orig_w, orig_h,
-                conf_thres=0.55,
-                iou_thres=0.45
-            )
+            detections = det.detect(frame_rgb, conf_thres=0.55, iou_thres=0.45)
 
             # soldier만 추출
             soldier_dets = [d for d in detections if d[2] == SOLDIER_CLASS_ID]
@@ -277,6 +325,125 @@ def main():
         servo_pwm.stop()
         GPIO.cleanup()
 
+# =========================
+# 벤치마크 / FP16 대비 정확도 비교
+# =========================
+def box_iou(a, b):
+    ix = max(0, min(a[2], b[2]) - max(a[0], b[0]))
+    iy = max(0, min(a[3], b[3]) - max(a[1], b[1]))
+    inter = ix * iy
+    union = (a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter
+    return inter / union if union > 0 else 0.0
+
+def leftmost_soldier_cx(dets):
+    soldiers = [d for d in dets if d[2] == SOLDIER_CLASS_ID]
+    if not soldiers:
+        return None
+    x1, _, x2, _ = min(soldiers, key=lambda d: d[0][0])[0]
+    return (x1 + x2) / 2.0
+
+def time_stages(det, frame_rgb, conf_thres):
+    t0 = time.perf_counter()
+    det.preprocess(frame_rgb)
+    t1 = time.perf_counter()
+    det.interpreter.invoke()
+    t2 = time.perf_counter()
+    pred = det.interpreter.get_tensor(det.out["index"])
+    if det.out_quant is None:
+        pred = pred.astype(np.float32)
+    orig_h, orig_w = frame_rgb.shape[:2]
+    dets = yolo_postprocess(pred, orig_w, orig_h, conf_thres, 0.45, det.out_quant)
+    t3 = time.perf_counter()
+    return dets, (t1 - t0, t2 - t1, t3 - t2)
+
+def print_timing(name, times):
+    t = np.array(times) * 1000.0   # ms
+    print(f"[{name}] {len(t)} frames")
+    for i, stage in enumerate(("preprocess", "invoke", "postprocess")):
+        print(f"  {stage:<12} mean={t[:, i].mean():7.3f} ms  p50={np.percentile(t[:, i], 50):7.3f}  "
+              f"p99={np.percentile(t[:, i], 99):7.3f}")
+    total = t.sum(axis=1)
+    print(f"  {'total':<12} mean={total.mean():7.3f} ms  ({1000.0 / total.mean():.1f} fps)")
+
+# 같은 카메라 프레임으로 단계별 시간 측정, ref(FP16)를 주면 검출 결과도 비교
+def run_bench(det, ref, n_frames, conf_thres=0.55, warmup=10):
+    for _ in range(warmup):
+        frame = picam2.capture_array()
+        det.detect(frame, conf_thres)
+        if ref is not None:
+            ref.detect(frame, conf_thres)
+
+    times, ref_times = [], []
+    matched = only_det = only_ref = 0
+    ious, score_diffs, cx_errs = [], [], []
+    soldier_agree = 0
+
+    for _ in range(n_frames):
+        frame = picam2.capture_array()
+        dets, t = time_stages(det, frame, conf_thres)
+        times.append(t)
+        if ref is None:
+            continue
+
+        ref_dets, t = time_stages(ref, frame, conf_thres)
+        ref_times.append(t)
+
+        # 같은 클래스끼리 IoU >= 0.5 면 같은 물체로 매칭 (greedy)
+        unused = list(range(len(ref_dets)))
+        for box, score, cid in dets:
+            best, best_iou = None, 0.5
+            for j in unused:
+                if ref_dets[j][2] != cid:
+                    continue
+                iou = box_iou(box, ref_dets[j][0])
+                if iou >= best_iou:
+                    best, best_iou = j, iou
+            if best is None:
+                only_det += 1
+            else:
+                unused.remove(best)
+                matched += 1
+                ious.append(best_iou)
+                score_diffs.append(abs(score - ref_dets[best][1]))
+        only_ref += len(unused)
+
+        # 서보 제어에 실제로 쓰이는 값: 가장 왼쪽 soldier 중심
+        cx, ref_cx = leftmost_soldier_cx(dets), leftmost_soldier_cx(ref_dets)
+        if (cx is None) == (ref_cx is None):
+            soldier_agree += 1
+            if cx is not None:
+                cx_errs.append(abs(cx - ref_cx))
+
+    print_timing("model", times)
+    if ref is None:
+        return
+
+    print_timing("ref", ref_times)
+    print(f"[compare] conf>={conf_thres} matched={matched} only_model={only_det} only_ref={only_ref}")
+    if ious:
+        print(f"  IoU mean={np.mean(ious):.3f} min={np.min(ious):.3f} | "
+              f"|score diff| mean={np.mean(score_diffs):.4f} max={np.max(score_diffs):.4f}")
+    print(f"  soldier 유무 일치 {soldier_agree}/{n_frames} frames", end="")
+    if cx_errs:
+        print(f" | 왼쪽 soldier 중심 오차 mean={np.mean(cx_errs):.2f}px max={np.max(cx_errs):.2f}px")
+    else:
+        print()
+
 if __name__ == "__main__":
-    main()
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", default="model.tflite")
+    parser.add_argument("--bench", type=int, metavar="N", help="서보 제어 대신 N 프레임 시간 측정")
+    parser.add_argument("--ref", metavar="FP16_MODEL", help="--bench 시 같은 프레임으로 비교할 기준 모델")
+    args = parser.parse_args()
+
+    det = Detector(args.model)
+    if args.bench:
+        try:
+            run_bench(det, Detector(args.ref) if args.ref else None, args.bench)
+        finally:
+            picam2.stop()
+            servo_pwm.stop()
+            GPIO.cleanup()
+    else:
+        main(det)
 
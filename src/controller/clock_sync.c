@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+#include "clock_sync.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+uint64_t clock_sync_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void clock_sync_init(Clock_Sync *cs) {
+    memset(cs, 0, sizeof(*cs));
+    pthread_mutex_init(&cs->lock, NULL);
+}
+
+// 필터 창에서 RTT 최소 샘플 채택 (cs->lock 잡은 상태)
+static void filter_select(Clock_Sync *cs) {
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < cs->filt_len; i++) {
+        if (cs->filt_rtt[i] < cs->filt_rtt[best]) best = i;
+    }
+    cs->offset_ns = cs->filt_off[best];
+    cs->rtt_ns    = cs->filt_rtt[best];
+    cs->valid     = 1;
+}
+
+void clock_sync_add_sample(Clock_Sync *cs, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+    int64_t rtt = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+    if (rtt < 0) rtt = 0;  // 차량측 처리시간이 더 길게 잡힌 경우 (해상도 오차)
+
+    int64_t off = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+
+    pthread_mutex_lock(&cs->lock);
+    cs->filt_off[cs->filt_idx] = off;
+    cs->filt_rtt[cs->filt_idx] = (uint64_t)rtt;
+    cs->filt_idx = (cs->filt_idx + 1) % CLOCK_FILTER_N;
+    if (cs->filt_len < CLOCK_FILTER_N) cs->filt_len++;
+    cs->last_rtt_ns = (uint64_t)rtt;
+    cs->samples++;
+    lat_hist_add(&cs->rtt_hist, (uint64_t)rtt);
+    filter_select(cs);
+    pthread_mutex_unlock(&cs->lock);
+}
+
+void clock_sync_adopt_remote(Clock_Sync *cs, int64_t remote_offset_ns,
+                             uint64_t rtt_ns, uint64_t last_rtt_ns, uint32_t sample_no) {
+    pthread_mutex_lock(&cs->lock);
+    cs->offset_ns   = -remote_offset_ns;
+    cs->rtt_ns      = rtt_ns;
+    cs->last_rtt_ns = last_rtt_ns;
+    if (!cs->valid || sample_no != cs->samples) lat_hist_add(&cs->rtt_hist, last_rtt_ns);
+    cs->samples     = sample_no;
+    cs->valid       = 1;
+    pthread_mutex_unlock(&cs->lock);
+}
+
+void clock_sync_answer_ping(Clock_Sync *cs, int fd, const Drive_Probe *pr, uint64_t t2,
+                            const struct sockaddr_in *src) {
+    if (pr->type != DRIVE_PROBE_PING) return;
+    if (pr->valid) clock_sync_adopt_remote(cs, pr->offset_ns, pr->rtt_ns, pr->last_rtt_ns, pr->sample_no);
+
+    uint8_t out[DRIVE_PROBE_PONG_LEN];
+    drive_probe_build_pong(out, pr->id, pr->t1, t2, clock_sync_now_ns());
+    sendto(fd, out, sizeof(out), 0, (const struct sockaddr *)src, sizeof(*src));
+}
+
+int clock_sync_get(Clock_Sync *cs, int64_t *offset_ns, uint64_t *rtt_ns) {
+    pthread_mutex_lock(&cs->lock);
+    int valid = cs->valid;
+    if (valid) {
+        if (offset_ns) *offset_ns = cs->offset_ns;
+        if (rtt_ns)    *rtt_ns    = cs->rtt_ns;
+    }
+    pthread_mutex_unlock(&cs->lock);
+    return valid;
+}
+
+uint64_t clock_sync_rtt_percentile(Clock_Sync *cs, double pct) {
+    pthread_mutex_lock(&cs->lock);
+    uint64_t v = lat_hist_percentile(&cs->rtt_hist, pct);
+    pthread_mutex_unlock(&cs->lock);
+    return v;
+}
+
+uint64_t clock_sync_to_local(Clock_Sync *cs, uint64_t remote_ns) {
+    int64_t off = 0;
+    clock_sync_get(cs, &off, NULL);
+    return remote_ns - (uint64_t)off;
+}
+
+// ---- 지연 히스토그램 ----
+
+// us 값 -> 버킷 번호
+static uint32_t lat_bucket(uint64_t us) {
+    if (us < LAT_HIST_SUB) return (uint32_t)us;
+
+    uint32_t e = 63u - (uint32_t)__builtin_clzll(us);           // 2^e <= us
+    uint32_t sub = (uint32_t)(us >> (e - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB - 1);
+    uint32_t b = (e - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB + sub;
+    return (b < LAT_HIST_BUCKETS) ? b : LAT_HIST_BUCKETS - 1;
+}
+
+// 버킷 상한 (ns, 미포함)
+static uint64_t lat_bucket_upper_ns(uint32_t b) {
+    if (b < LAT_HIST_SUB) return (uint64_t)(b + 1) * 1000u;
+
+    uint32_t e = b / LAT_HIST_SUB + LAT_HIST_SUB_BITS - 1;
+    uint64_t sub = b % LAT_HIST_SUB;
+    return ((LAT_HIST_SUB + sub + 1) << (e - LAT_HIST_SUB_BITS)) * 1000u;
+}
+
+void lat_hist_add(Lat_Hist *h, uint64_t ns) {
+    uint32_t b = lat_bucket(ns / 1000u);
+    h->bucket[b]++;
+    h->count++;
+    if (ns > h->max_ns) h->max_ns = ns;
+}
+
+uint64_t lat_hist_percentile(const Lat_Hist *h, double pct) {
+    if (h->count == 0) return 0;
+
+    uint32_t target = (uint32_t)(h->count * pct / 100.0);
+    uint32_t acc = 0;
+    for (uint32_t b = 0; b < LAT_HIST_BUCKETS; b++) {
+        acc += h->bucket[b];
+        if (acc > target) {
+            uint64_t upper = lat_bucket_upper_ns(b);
+            return (upper < h->max_ns) ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
@@ -0,0 +1,82 @@
+#ifndef __CLOCK_SYNC_H__
+#define __CLOCK_SYNC_H__
+
+#include "drive_protocol.h"
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+
+// 컨트롤러 <-> 차량 시계 차이(offset)와 RTT 추정 (NTP 방식 4-타임스탬프)
+//
+//   t1: 컨트롤러가 probe 송신     t2: 차량이 probe 수신
+//   t3: 차량이 응답 송신          t4: 컨트롤러가 응답 수신
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2   (상대 시계 - 내 시계)
+//   rtt    = (t4 - t1) - (t3 - t2)
+//
+// 네트워크 지연이 비대칭일수록 offset 오차가 커지므로, 최근 CLOCK_FILTER_N개 샘플 중
+// RTT가 가장 작은 샘플의 offset을 채택 (NTP clock filter와 같은 방식).
+// 시계는 양쪽 모두 CLOCK_MONOTONIC 기준.
+
+#define CLOCK_FILTER_N     8
+
+// 지연 히스토그램: us 단위 log2 구간을 다시 LAT_HIST_SUB개로 균등 분할 (상대 오차 <= 1/LAT_HIST_SUB)
+//   0 .. LAT_HIST_SUB-1 us 는 1us 간격, 그 위로는 [2^e, 2^(e+1)) us 를 LAT_HIST_SUB칸으로
+#define LAT_HIST_SUB_BITS  3
+#define LAT_HIST_SUB       (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_BUCKETS   ((32 - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB)
+typedef struct {
+    uint32_t bucket[LAT_HIST_BUCKETS];
+    uint32_t count;
+    uint64_t max_ns;
+} Lat_Hist;
+
+typedef struct {
+    pthread_mutex_t lock;
+
+    int64_t  filt_off[CLOCK_FILTER_N];
+    uint64_t filt_rtt[CLOCK_FILTER_N];
+    uint32_t filt_len;
+    uint32_t filt_idx;
+
+    int      valid;
+    int64_t  offset_ns;   // 상대 시계 - 내 시계
+    uint64_t rtt_ns;      // 채택된 샘플의 RTT
+    uint64_t last_rtt_ns; // 가장 최근 샘플의 RTT
+    uint32_t samples;     // 컨트롤러: 누적 샘플 수 / 차량: 마지막으로 반영한 컨트롤러 샘플 번호
+
+    Lat_Hist rtt_hist;
+} Clock_Sync;
+
+uint64_t clock_sync_now_ns(void);
+
+void clock_sync_init(Clock_Sync *cs);
+
+// 컨트롤러측: probe 왕복 한 번의 네 타임스탬프로 갱신
+void clock_sync_add_sample(Clock_Sync *cs, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+// 차량측: 컨트롤러가 probe에 실어 보낸 추정값을 그대로 채택
+// (offset은 컨트롤러 기준이므로 부호를 뒤집어 저장)
+// RTT 히스토그램에는 sample_no가 바뀌었을 때만 반영 (PONG 유실로 같은 샘플이 다시 와도 한 번만)
+void clock_sync_adopt_remote(Clock_Sync *cs, int64_t remote_offset_ns,
+                             uint64_t rtt_ns, uint64_t last_rtt_ns, uint32_t sample_no);
+
+// 차량측: 컨트롤러의 PING(t2에 수신)에 PONG으로 응답하고, 실려 온 추정값을 채택. PING이 아니면 무시
+void clock_sync_answer_ping(Clock_Sync *cs, int fd, const Drive_Probe *pr, uint64_t t2,
+                            const struct sockaddr_in *src);
+
+// 추정값 조회, 아직 샘플이 없으면 0 (out은 그대로)
+int  clock_sync_get(Clock_Sync *cs, int64_t *offset_ns, uint64_t *rtt_ns);
+
+// RTT 분위수 (버킷 상한값, ns, 최대 1/LAT_HIST_SUB만큼 크게 나옴). 샘플이 없으면 0
+uint64_t clock_sync_rtt_percentile(Clock_Sync *cs, double pct);
+
+// 상대 시계의 시각을 내 시계 기준으로 변환 (offset 미확정이면 그대로)
+uint64_t clock_sync_to_local(Clock_Sync *cs, uint64_t remote_ns);
+
+// ---- 지연 히스토그램 (락 없음, 호출자가 동기화) ----
+void     lat_hist_add(Lat_Hist *h, uint64_t ns);
+uint64_t lat_hist_percentile(const Lat_Hist *h, double pct);
+
+#endif
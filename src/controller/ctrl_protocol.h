@@ -13,6 +13,7 @@ typedef struct {
 
 typedef struct { uint8_t _dummy; } Track_Start_Payload;
 typedef struct { uint8_t _dummy; } Track_Stop_Payload;
+typedef struct { uint8_t _dummy; } Estop_Payload;
 
 typedef struct {
     uint8_t r;          // 0~255
@@ -31,6 +32,7 @@ typedef union {
     Track_Stop_Payload       track_stop_payload;
     HeadLight_Ctrl_Payload   headlight_ctrl_payload;
     Laser_Ctrl_Payload       laser_ctrl_payload;
+    Estop_Payload            estop_payload;
 } Payload;
 
 typedef struct {
@@ -47,6 +49,45 @@ enum {
     CMD_TRACK_STOP  = 0x12,
     CMD_HEADLIGHT   = 0x13,
     CMD_LASER       = 0x14,
+    CMD_ESTOP       = 0x15,  // 차량은 해제 명령이 올 때까지 정지 유지 (주행 입력 무시)
+    CMD_ESTOP_CLEAR = 0x16,  // 비상 정지 해제
 };
 
+// 명령 우선순위 (값이 작을수록 먼저 송신)
+enum {
+    CTRL_PRIO_ESTOP    = 0,  // 비상 정지
+    CTRL_PRIO_DRIVE    = 1,  // 주행
+    CTRL_PRIO_TRACK    = 2,  // 추적 시작/정지, 레이저
+    CTRL_PRIO_COSMETIC = 3,  // 헤드라이트
+    CTRL_PRIO_COUNT
+};
+
+static inline int ctrl_cmd_priority(uint8_t cmd) {
+    switch (cmd) {
+        case CMD_ESTOP:
+        case CMD_ESTOP_CLEAR: return CTRL_PRIO_ESTOP;   // 같은 큐라서 정지/해제 순서 유지
+        case CMD_DRIVE:       return CTRL_PRIO_DRIVE;
+        case CMD_TRACK_START:
+        case CMD_TRACK_STOP:
+        case CMD_LASER:       return CTRL_PRIO_TRACK;
+        default:              return CTRL_PRIO_COSMETIC;
+    }
+}
+
+// 차량측 CAN ID: 버스 중재는 ID가 작을수록 이기므로 우선순위 순서대로 배치
+// (주행은 기존 0x123 유지)
+#define CAN_ID_ESTOP    0x020
+#define CAN_ID_DRIVE    0x123
+#define CAN_ID_TRACK    0x200
+#define CAN_ID_COSMETIC 0x300
+// 차량 -> 상위 상태 보고 (가장 낮은 우선순위)
+#define CAN_ID_STATUS   0x400
+
+static inline uint32_t ctrl_priority_can_id(int prio) {
+    static const uint32_t ids[CTRL_PRIO_COUNT] = {
+        CAN_ID_ESTOP, CAN_ID_DRIVE, CAN_ID_TRACK, CAN_ID_COSMETIC
+    };
+    return (prio >= 0 && prio < CTRL_PRIO_COUNT) ? ids[prio] : CAN_ID_COSMETIC;
+}
+
 #endif
\ No newline at end of file
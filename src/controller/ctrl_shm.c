@@ -0,0 +1,258 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ctrl_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CTRL_SHM_MAGIC   0x52434D51u  // "RCMQ"
+#define CTRL_SHM_VERSION 3u
+#define CACHE_LINE       64
+
+// 생산자가 소비자 생존을 kill(pid, 0)로 확인하는 간격 (호출 횟수, fast path의 시스템콜을 줄이기 위함)
+#define CONSUMER_CHECK_INTERVAL 256u
+
+// 생산자 하나의 전용 슬롯
+// 생산자/소비자가 쓰는 필드를 캐시라인 단위로 분리 (false sharing 방지)
+typedef struct {
+    alignas(CACHE_LINE) _Atomic int32_t producer_pid;   // 붙어 있는 생산자 (0이면 없음)
+
+    // 주행 상태 seqlock: 홀수면 쓰는 중
+    alignas(CACHE_LINE) _Atomic uint32_t drive_seq;
+    Drive_Payload drive;
+
+    // SPSC 링: head는 생산자만, tail은 소비자만 씀
+    alignas(CACHE_LINE) _Atomic uint32_t head;
+    alignas(CACHE_LINE) _Atomic uint32_t tail;
+    alignas(CACHE_LINE) Ctrl_Message ring[CTRL_SHM_RING_SIZE];
+} Ctrl_Shm_Slot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  consumer_pid;              // 채널을 만든 소비자(데몬)
+    _Atomic uint32_t consumer_epoch;    // 소비자 실행마다 다른 값, 소비자가 떠나면 0
+    Ctrl_Shm_Slot slot[CTRL_SHM_MAX_PRODUCERS];
+} Ctrl_Shm;
+
+static Ctrl_Shm *g_shm = NULL;
+static Ctrl_Shm_Slot *g_slot = NULL;   // 생산자: 내 슬롯, 소비자: NULL
+
+// 생산자 쪽 캐시: 소비자 tail을 매번 읽지 않도록
+static uint32_t g_cached_tail = 0;
+
+// 생산자: attach 시점의 소비자 epoch, 생존 확인까지 남은 호출 수
+static uint32_t g_epoch = 0;
+static uint32_t g_check_left = 0;
+
+static Ctrl_Shm *map_shm(int fd) {
+    void *p = mmap(NULL, sizeof(Ctrl_Shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (p == MAP_FAILED) ? NULL : (Ctrl_Shm *)p;
+}
+
+static int consumer_alive(const Ctrl_Shm *s) {
+    if (atomic_load_explicit(&s->consumer_epoch, memory_order_acquire) == 0) return 0;
+    return kill((pid_t)s->consumer_pid, 0) == 0 || errno != ESRCH;
+}
+
+int ctrl_shm_create(const char *name) {
+    if (g_shm) return -1;
+
+    // 데몬이 새로 시작하면 채널도 새로 만듦. 기존 객체를 다시 열어 초기화하면
+    // 아직 붙어 있는 생산자의 슬롯이 지워져 한 링에 생산자 둘이 쓰게 될 수 있음.
+    // 이전 생산자는 옛 객체에 남아 -1(EPIPE)을 받고 다시 attach 함.
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)sizeof(Ctrl_Shm)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    Ctrl_Shm *s = map_shm(fd);
+    if (!s) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    // ftruncate로 늘어난 영역은 0으로 채워져 있음
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint32_t epoch = (uint32_t)getpid() ^ (uint32_t)ts.tv_nsec ^ ((uint32_t)ts.tv_sec << 20);
+    s->version = CTRL_SHM_VERSION;
+    s->consumer_pid = (int32_t)getpid();
+    atomic_store_explicit(&s->consumer_epoch, epoch ? epoch : 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s->magic = CTRL_SHM_MAGIC;
+
+    g_shm = s;
+    g_slot = NULL;
+    return 0;
+}
+
+// 슬롯 차지: 비어 있거나, 이전 생산자가 죽었으면 가져옴
+static int claim_slot(Ctrl_Shm_Slot *sl, int32_t me) {
+    int32_t cur = atomic_load(&sl->producer_pid);
+    while (1) {
+        if (cur == me) return 0;
+        if (cur != 0 && (kill((pid_t)cur, 0) == 0 || errno != ESRCH)) return -1;
+        if (atomic_compare_exchange_weak(&sl->producer_pid, &cur, me)) break;
+    }
+
+    // 이전 생산자가 seqlock 쓰는 도중 죽었으면 짝수로 돌려놓음
+    uint32_t seq = atomic_load_explicit(&sl->drive_seq, memory_order_relaxed);
+    if (seq & 1u) atomic_store_explicit(&sl->drive_seq, seq + 1, memory_order_release);
+    return 0;
+}
+
+int ctrl_shm_attach(const char *name) {
+    if (g_shm) return -1;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return -1;
+
+    Ctrl_Shm *s = map_shm(fd);
+    if (!s) return -1;
+
+    if (s->magic != CTRL_SHM_MAGIC || s->version != CTRL_SHM_VERSION) {
+        munmap(s, sizeof(*s));
+        errno = EPROTO;
+        return -1;
+    }
+    if (!consumer_alive(s)) {
+        munmap(s, sizeof(*s));
+        errno = ECONNREFUSED;
+        return -1;
+    }
+
+    int32_t me = (int32_t)getpid();
+    Ctrl_Shm_Slot *sl = NULL;
+    for (int i = 0; i < CTRL_SHM_MAX_PRODUCERS; i++) {
+        if (claim_slot(&s->slot[i], me) == 0) {
+            sl = &s->slot[i];
+            break;
+        }
+    }
+    if (!sl) {
+        munmap(s, sizeof(*s));
+        errno = EBUSY;
+        return -1;
+    }
+
+    g_shm = s;
+    g_slot = sl;
+    g_cached_tail = atomic_load_explicit(&sl->tail, memory_order_acquire);
+    g_epoch = atomic_load_explicit(&s->consumer_epoch, memory_order_acquire);
+    g_check_left = CONSUMER_CHECK_INTERVAL;
+    return 0;
+}
+
+void ctrl_shm_detach(void) {
+    if (!g_shm) return;
+
+    int32_t me = (int32_t)getpid();
+    if (g_slot) {
+        atomic_compare_exchange_strong(&g_slot->producer_pid, &me, 0);
+    } else if (g_shm->consumer_pid == me) {
+        // 소비자가 떠남: 남은 생산자들이 다음 호출에서 알 수 있게 (fork된 자식은 해당 없음)
+        atomic_store_explicit(&g_shm->consumer_epoch, 0, memory_order_release);
+    }
+    munmap(g_shm, sizeof(*g_shm));
+    g_shm = NULL;
+    g_slot = NULL;
+}
+
+void ctrl_shm_unlink(const char *name) {
+    shm_unlink(name);
+}
+
+int ctrl_shm_slot_pid(int slot) {
+    return (int)atomic_load_explicit(&g_shm->slot[slot].producer_pid, memory_order_relaxed);
+}
+
+// 생산자: attach한 소비자가 아직 그대로인지 확인.
+// epoch 비교는 매번 (시스템콜 없음), 프로세스 생존 확인은 CONSUMER_CHECK_INTERVAL 번마다 또는 force일 때
+static int consumer_check(int force) {
+    int gone = atomic_load_explicit(&g_shm->consumer_epoch, memory_order_relaxed) != g_epoch;
+    if (!gone && (force || --g_check_left == 0)) {
+        g_check_left = CONSUMER_CHECK_INTERVAL;
+        gone = kill((pid_t)g_shm->consumer_pid, 0) != 0 && errno == ESRCH;
+    }
+    if (gone) errno = EPIPE;
+    return gone ? -1 : 0;
+}
+
+// ---- 주행 상태 (seqlock) ----
+
+int ctrl_shm_set_drive(const Drive_Payload *s) {
+    Ctrl_Shm_Slot *sl = g_slot;
+    if (consumer_check(0) != 0) return -1;
+    uint32_t seq = atomic_load_explicit(&sl->drive_seq, memory_order_relaxed);
+
+    atomic_store_explicit(&sl->drive_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&sl->drive, s, sizeof(*s));
+    atomic_store_explicit(&sl->drive_seq, seq + 2, memory_order_release);
+    return 0;
+}
+
+int ctrl_shm_get_drive(int slot, Drive_Payload *out, uint32_t *gen) {
+    Ctrl_Shm_Slot *sl = &g_shm->slot[slot];
+    uint32_t s1, s2;
+    Drive_Payload tmp;
+
+    do {
+        s1 = atomic_load_explicit(&sl->drive_seq, memory_order_acquire);
+        if (s1 == *gen) return 0;       // 바뀐 것 없음
+        if (s1 & 1u) return 0;          // 쓰는 중이면 다음 폴링 때 (생산자가 죽어도 멈추지 않게)
+        memcpy(&tmp, &sl->drive, sizeof(tmp));
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&sl->drive_seq, memory_order_relaxed);
+    } while (s1 != s2);
+
+    *out = tmp;
+    *gen = s1;
+    return 1;
+}
+
+// ---- 제어 명령 (SPSC 링) ----
+
+int ctrl_shm_push(const Ctrl_Message *msg) {
+    Ctrl_Shm_Slot *sl = g_slot;
+    uint32_t head = atomic_load_explicit(&sl->head, memory_order_relaxed);
+
+    if (head - g_cached_tail >= CTRL_SHM_RING_SIZE) {
+        g_cached_tail = atomic_load_explicit(&sl->tail, memory_order_acquire);
+        if (head - g_cached_tail >= CTRL_SHM_RING_SIZE) {
+            // 가득 참: 소비자가 죽어서 안 비우는 것인지 바로 확인
+            if (consumer_check(1) != 0) return -1;
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+    if (consumer_check(0) != 0) return -1;
+
+    sl->ring[head & (CTRL_SHM_RING_SIZE - 1)] = *msg;
+    atomic_store_explicit(&sl->head, head + 1, memory_order_release);
+    return 0;
+}
+
+int ctrl_shm_pop(int slot, Ctrl_Message *out) {
+    Ctrl_Shm_Slot *sl = &g_shm->slot[slot];
+    uint32_t tail = atomic_load_explicit(&sl->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&sl->head, memory_order_acquire);
+    if (tail == head) return 0;
+
+    *out = sl->ring[tail & (CTRL_SHM_RING_SIZE - 1)];
+    atomic_store_explicit(&sl->tail, tail + 1, memory_order_release);
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef __CTRL_SHM_H__
+#define __CTRL_SHM_H__
+
+#include "ctrl_protocol.h"
+
+// 같은 머신의 여러 프로세스(조이스틱, UI, 오토파일럿)가 송신 데몬에 명령을 넘기는 공유메모리 채널
+//
+// 생산자마다 전용 슬롯 하나 (최대 CTRL_SHM_MAX_PRODUCERS개 동시 연결):
+// - 제어 명령: lock-free SPSC 링 (Ctrl_Message 단위)
+// - 주행 상태: seqlock 슬롯 (최신값만 의미 있음, 덮어쓰기)
+//
+// 슬롯끼리 공유하는 쓰기 필드가 없으므로 생산자 사이에도 락/CAS가 없음 (자리 차지할 때만 CAS).
+// 소비자(송신 데몬)는 모든 슬롯을 폴링으로 읽기 때문에 fast path에 시스템콜이 없음.
+
+#define CTRL_SHM_DEFAULT_NAME  "/rc_car_ctrl"
+#define CTRL_SHM_RING_SIZE     256   // 2의 거듭제곱
+#define CTRL_SHM_MAX_PRODUCERS 8
+
+// 소비자(데몬): 같은 이름의 이전 채널을 지우고 새로 생성 후 연결
+int  ctrl_shm_create(const char *name);
+// 생산자: 기존 공유메모리의 빈 슬롯(또는 죽은 생산자의 슬롯)에 연결
+// 자리가 없으면 -1 (EBUSY), 소비자가 없으면 -1 (ECONNREFUSED)
+int  ctrl_shm_attach(const char *name);
+void ctrl_shm_detach(void);
+void ctrl_shm_unlink(const char *name);
+
+// ---- 생산자 (자기 슬롯에만 씀) ----
+// 소비자가 종료/재시작했으면 둘 다 -1 (EPIPE): ctrl_shm_detach() 후 다시 attach 해야 함
+// 주행 상태 갱신 (seqlock 슬롯에 덮어씀)
+int  ctrl_shm_set_drive(const Drive_Payload *s);
+// 제어 명령 넣기, 링이 가득 차면 -1 (EAGAIN)
+int  ctrl_shm_push(const Ctrl_Message *msg);
+
+// ---- 소비자 (slot: 0 .. CTRL_SHM_MAX_PRODUCERS-1) ----
+// 해당 슬롯을 생산자가 차지하고 있으면 pid, 비었으면 0
+int  ctrl_shm_slot_pid(int slot);
+// 주행 상태가 *gen 이후로 바뀌었으면 1 (out, *gen 갱신), 그대로거나 쓰는 중이면 0
+int  ctrl_shm_get_drive(int slot, Drive_Payload *out, uint32_t *gen);
+// 제어 명령 꺼내기, 있으면 1 / 비었으면 0
+int  ctrl_shm_pop(int slot, Ctrl_Message *out);
+
+#endif
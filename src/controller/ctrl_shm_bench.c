@@ -0,0 +1,199 @@
+// ctrl_shm_bench.c
+// 프로세스 간 명령 전달 지연 비교: 공유메모리 SPSC 링 vs 루프백 UDP
+// 생산자/소비자를 fork로 분리하고, 메시지마다 송신/수신 시각(CLOCK_MONOTONIC)을 기록
+#define _DEFAULT_SOURCE
+#include "ctrl_shm.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_SHM_NAME "/rc_car_ctrl_bench"
+#define BENCH_UDP_PORT 47001
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 송신 간격을 두어 큐 적체가 아닌 순수 전달 지연을 봄
+static void pace(uint64_t start, uint32_t i, uint32_t gap_ns) {
+    uint64_t due = start + (uint64_t)i * gap_ns;
+    while (now_ns() < due) {}
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, const uint64_t *tx, const uint64_t *rx, uint32_t n) {
+    uint64_t *lat = malloc(sizeof(uint64_t) * n);
+    uint32_t got = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (rx[i]) lat[got++] = rx[i] - tx[i];
+    }
+    if (got == 0) {
+        printf("%-12s no messages received\n", name);
+        free(lat);
+        return;
+    }
+    qsort(lat, got, sizeof(uint64_t), cmp_u64);
+    printf("%-12s n=%u/%u  p50=%6.2f us  p99=%7.2f us  p99.9=%7.2f us  max=%8.2f us\n",
+           name, got, n,
+           lat[got / 2] / 1e3, lat[(uint64_t)got * 99 / 100] / 1e3,
+           lat[(uint64_t)got * 999 / 1000] / 1e3, lat[got - 1] / 1e3);
+    free(lat);
+}
+
+static void msg_set_index(Ctrl_Message *m, uint32_t i) {
+    memset(m, 0, sizeof(*m));
+    m->cmd = CMD_HEADLIGHT;
+    memcpy(&m->payload, &i, sizeof(i));
+}
+
+static uint32_t msg_index(const Ctrl_Message *m) {
+    uint32_t i;
+    memcpy(&i, &m->payload, sizeof(i));
+    return i;
+}
+
+static void bench_shm(uint64_t *tx, uint64_t *rx, uint32_t n, uint32_t gap_ns) {
+    if (ctrl_shm_create(BENCH_SHM_NAME) != 0) {
+        perror("ctrl_shm_create");
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        ctrl_shm_detach();
+        if (ctrl_shm_attach(BENCH_SHM_NAME) != 0) _exit(1);
+        uint64_t start = now_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            Ctrl_Message m;
+            msg_set_index(&m, i);
+            pace(start, i, gap_ns);
+            tx[i] = now_ns();
+            while (ctrl_shm_push(&m) != 0) {
+                if (errno == EPIPE) _exit(1);   // 소비자가 사라짐
+            }
+        }
+        ctrl_shm_detach();
+        _exit(0);
+    }
+
+    // 소비자: 데몬과 같은 바쁜 폴링
+    uint32_t empty = 0;
+    int reaped = 0;
+    for (uint32_t got = 0; got < n; ) {
+        Ctrl_Message m;
+        if (ctrl_shm_pop(0, &m)) {   // 생산자 하나뿐이므로 첫 슬롯
+            uint64_t t = now_ns();
+            uint32_t i = msg_index(&m);
+            if (i < n) rx[i] = t;
+            got++;
+            empty = 0;
+        } else if (++empty == (1u << 20)) {
+            // 생산자가 죽었으면 (attach 실패 등) 멈춤
+            empty = 0;
+            if (waitpid(pid, NULL, WNOHANG) == pid) { reaped = 1; break; }
+        }
+    }
+    if (!reaped) waitpid(pid, NULL, 0);
+    ctrl_shm_detach();
+    ctrl_shm_unlink(BENCH_SHM_NAME);
+}
+
+static void bench_udp(uint64_t *tx, uint64_t *rx, uint32_t n, uint32_t gap_ns) {
+    int rfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(BENCH_UDP_PORT);
+    int buf = 4 * 1024 * 1024;
+    setsockopt(rfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    if (rfd < 0 || bind(rfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        if (rfd >= 0) close(rfd);
+        return;
+    }
+    // 끝에 유실이 있어도 멈추지 않도록
+    struct timeval tv = { 1, 0 };
+    setsockopt(rfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(rfd);
+        int sfd = socket(AF_INET, SOCK_DGRAM, 0);
+        uint64_t start = now_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            Ctrl_Message m;
+            msg_set_index(&m, i);
+            pace(start, i, gap_ns);
+            tx[i] = now_ns();
+            sendto(sfd, &m, sizeof(m), 0, (struct sockaddr *)&addr, sizeof(addr));
+        }
+        close(sfd);
+        _exit(0);
+    }
+
+    for (uint32_t got = 0; got < n; got++) {
+        Ctrl_Message m;
+        ssize_t r = recv(rfd, &m, sizeof(m), 0);
+        if (r < 0) {
+            if (errno == EINTR) { got--; continue; }
+            break;
+        }
+        uint64_t t = now_ns();
+        uint32_t i = msg_index(&m);
+        if (r == (ssize_t)sizeof(m) && i < n) rx[i] = t;
+    }
+    waitpid(pid, NULL, 0);
+    close(rfd);
+}
+
+int main(int argc, char **argv) {
+    uint32_t n      = (argc > 1) ? (uint32_t)atoi(argv[1]) : 100000;
+    uint32_t gap_us = (argc > 2) ? (uint32_t)atoi(argv[2]) : 20;
+    if (n == 0) {
+        fprintf(stderr, "Usage: %s [messages] [gap_us]\n", argv[0]);
+        return 1;
+    }
+
+    // 자식 프로세스의 송신 시각을 부모가 읽을 수 있도록 공유 매핑 사용
+    size_t bytes = sizeof(uint64_t) * n;
+    uint64_t *tx = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    uint64_t *rx = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (tx == MAP_FAILED || rx == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("%u messages, one every %u us (%zu bytes each)\n", n, gap_us, sizeof(Ctrl_Message));
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        // 생산자/소비자 모두 바쁜 폴링이라 코어 하나면 서로 타임슬라이스를 기다리게 됨
+        printf("[WARN] single CPU: spin-polling results are not representative\n");
+    }
+
+    memset(tx, 0, bytes); memset(rx, 0, bytes);
+    bench_shm(tx, rx, n, gap_us * 1000u);
+    report("shm spsc", tx, rx, n);
+
+    memset(tx, 0, bytes); memset(rx, 0, bytes);
+    bench_udp(tx, rx, n, gap_us * 1000u);
+    report("udp loopback", tx, rx, n);
+
+    munmap(tx, bytes);
+    munmap(rx, bytes);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// ctrl_shm_daemon.c
+// 공유메모리 채널(ctrl_shm)을 읽어서 RC카로 송신하는 데몬
+// - 주행 상태 -> drive_tx_udp (주기 송신)
+// - 제어 명령 -> ctrl_tx_tcp
+// 생산자(조이스틱, UI, 오토파일럿 ...)는 각자 슬롯을 받아 동시에 붙을 수 있음
+#define _POSIX_C_SOURCE 200809L
+#include "ctrl_shm.h"
+#include "ctrl_tx_tcp.h"
+#include "drive_tx_udp.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// 일이 없을 때만 잠깐 잠듦. 바쁠 때는 시스템콜 없이 계속 폴링
+#define IDLE_SPIN_LOOPS 2000
+#define IDLE_SLEEP_US   200
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void sleep_us(long us) {
+    struct timespec ts = { 0, us * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static void dispatch(const Ctrl_Message *m) {
+    if (m->cmd == CMD_DRIVE) {
+        const Drive_Payload *d = &m->payload.drive_payload;
+        drive_set_state(d->steering_deg, d->gear, d->speed);
+        return;
+    }
+    if (ctrl_send_message(m) != 0) {
+        fprintf(stderr, "[WARN] ctrl_send_message failed (cmd=0x%02X)\n", m->cmd);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 6) {
+        fprintf(stderr, "Usage: %s <car_ip> <drive_udp_port> <ctrl_tcp_port> [period_ms] [shm_name]\n",
+                argv[0]);
+        return 1;
+    }
+
+    const char *car_ip     = argv[1];
+    uint16_t    drive_port = (uint16_t)atoi(argv[2]);
+    uint16_t    ctrl_port  = (uint16_t)atoi(argv[3]);
+    uint32_t    period_ms  = (argc > 4) ? (uint32_t)atoi(argv[4]) : 20;
+    const char *shm_name   = (argc > 5) ? argv[5] : CTRL_SHM_DEFAULT_NAME;
+
+    if (ctrl_shm_create(shm_name) != 0) {
+        perror("ctrl_shm_create");
+        return 1;
+    }
+
+    struct sigaction sa;
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // TCP는 처음 연결 실패해도 송신 스레드가 다음 메시지 때 재연결 시도 (이때도 0)
+    if (ctrl_client_init(car_ip, ctrl_port) != 0) {
+        perror("ctrl_client_init");
+        ctrl_shm_detach();
+        ctrl_shm_unlink(shm_name);
+        return 1;
+    }
+    if (drive_udp_start(car_ip, drive_port, period_ms) != 0) {
+        perror("drive_udp_start");
+        ctrl_shm_detach();
+        ctrl_shm_unlink(shm_name);
+        return 1;
+    }
+
+    printf("ctrl_shm daemon: shm=%s -> %s (drive udp:%u every %ums, ctrl tcp:%u)\n",
+           shm_name, car_ip, drive_port, period_ms, ctrl_port);
+
+    uint32_t gen[CTRL_SHM_MAX_PRODUCERS] = {0};
+    int      pid[CTRL_SHM_MAX_PRODUCERS] = {0};
+    uint32_t idle = 0;
+
+    while (!g_stop) {
+        int busy = 0;
+
+        // 생산자별 슬롯을 모두 훑음. 주행 상태는 마지막으로 바뀐 슬롯의 값이 이김
+        for (int i = 0; i < CTRL_SHM_MAX_PRODUCERS; i++) {
+            int p = ctrl_shm_slot_pid(i);
+            if (p != pid[i]) {
+                if (p) printf("[SHM] slot %d: producer pid %d attached\n", i, p);
+                else   printf("[SHM] slot %d: producer pid %d detached\n", i, pid[i]);
+                fflush(stdout);
+                pid[i] = p;
+            }
+
+            Drive_Payload d;
+            if (ctrl_shm_get_drive(i, &d, &gen[i])) {
+                drive_set_state(d.steering_deg, d.gear, d.speed);
+                busy = 1;
+            }
+
+            // 빈 슬롯도 확인: 떠난 생산자가 남긴 명령까지 전달
+            Ctrl_Message m;
+            while (ctrl_shm_pop(i, &m)) {
+                dispatch(&m);
+                busy = 1;
+            }
+        }
+
+        if (busy) {
+            idle = 0;
+        } else if (++idle > IDLE_SPIN_LOOPS) {
+            sleep_us(IDLE_SLEEP_US);
+        }
+    }
+
+    drive_udp_stop();
+    ctrl_client_close();
+    ctrl_shm_detach();
+    ctrl_shm_unlink(shm_name);
+    return 0;
+}
@@ -4,20 +4,56 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
+// 송신 큐: 우선순위별 FIFO, 노드는 고정 풀에서 꺼내 씀 (런타임 malloc 없음)
+// ctrl_send_*()는 큐에 넣기만 하고, 송신 스레드가 항상 가장 높은 우선순위부터 보냄
+#define CTRL_POOL_SIZE       64
+#define CTRL_RETRY_MS        100   // 비상정지 재전송 대기
+// 커널 송신 버퍼에 미리 쌓아두는 양을 줄여서 우선순위 역전을 막음
+#define CTRL_NOTSENT_LOWAT   (4 * (int)sizeof(Ctrl_Message))
+
+typedef struct Ctrl_Node {
+    Ctrl_Message      msg;
+    uint64_t          enq_ns;
+    struct Ctrl_Node *next;
+} Ctrl_Node;
+
 static int g_fd = -1;
 static struct sockaddr_in g_addr;
 
+static pthread_mutex_t g_qlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_qcond = PTHREAD_COND_INITIALIZER;
+static Ctrl_Node  g_pool[CTRL_POOL_SIZE];
+static Ctrl_Node *g_free = NULL;
+static Ctrl_Node *g_qhead[CTRL_PRIO_COUNT];
+static Ctrl_Node *g_qtail[CTRL_PRIO_COUNT];
+static int g_pool_ready = 0;
+
+static pthread_t g_thread;
+static int g_running = 0;   // 송신 스레드 동작 중
+static int g_closing = 0;   // 남은 큐만 비우고 종료
+
+static Ctrl_Prio_Stats g_stats[CTRL_PRIO_COUNT];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 static int send_all(int fd, const void *buf, size_t len) {
     const uint8_t *p = (const uint8_t*)buf;
     size_t sent = 0;
 
     while (sent < len) {
-        ssize_t n = send(fd, p + sent, len - sent, 0);
+        ssize_t n = send(fd, p + sent, len - sent, MSG_NOSIGNAL);
         if (n > 0) { sent += (size_t)n; continue; }
         if (n == 0) return -1;
         if (errno == EINTR) continue;
@@ -37,6 +73,10 @@ static int ensure_connected(void) {
     setsockopt(g_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
     // 선택: keepalive
     setsockopt(g_fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+#ifdef TCP_NOTSENT_LOWAT
+    int lowat = CTRL_NOTSENT_LOWAT;
+    setsockopt(g_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+#endif
 
     if (connect(g_fd, (struct sockaddr *)&g_addr, sizeof(g_addr)) < 0) {
         close(g_fd);
@@ -46,33 +86,209 @@ static int ensure_connected(void) {
     return 0;
 }
 
+static void close_fd(void) {
+    if (g_fd >= 0) {
+        close(g_fd);
+        g_fd = -1;
+    }
+}
+
+// 미전송 데이터가 lowat 아래로 내려갈 때까지 대기 (큐에서 꺼내는 시점을 늦춤)
+static int wait_writable(int fd) {
+    struct pollfd pfd = { fd, POLLOUT, 0 };
+    while (1) {
+        int r = poll(&pfd, 1, 1000);
+        if (r > 0) return (pfd.revents & (POLLERR | POLLHUP)) ? -1 : 0;
+        if (r == 0) return -1;
+        if (errno != EINTR) return -1;
+    }
+}
+
+// ---- 큐 (g_qlock 잡은 상태에서 호출) ----
+
+static void pool_init(void) {
+    g_free = NULL;
+    for (int i = CTRL_POOL_SIZE - 1; i >= 0; i--) {
+        g_pool[i].next = g_free;
+        g_free = &g_pool[i];
+    }
+    memset(g_qhead, 0, sizeof(g_qhead));
+    memset(g_qtail, 0, sizeof(g_qtail));
+    g_pool_ready = 1;
+}
+
+static void q_push_back(int prio, Ctrl_Node *n) {
+    n->next = NULL;
+    if (g_qtail[prio]) g_qtail[prio]->next = n;
+    else               g_qhead[prio] = n;
+    g_qtail[prio] = n;
+}
+
+static void q_push_front(int prio, Ctrl_Node *n) {
+    n->next = g_qhead[prio];
+    g_qhead[prio] = n;
+    if (!g_qtail[prio]) g_qtail[prio] = n;
+}
+
+static Ctrl_Node *q_pop(int prio) {
+    Ctrl_Node *n = g_qhead[prio];
+    if (!n) return NULL;
+    g_qhead[prio] = n->next;
+    if (!g_qhead[prio]) g_qtail[prio] = NULL;
+    return n;
+}
+
+static Ctrl_Node *q_pop_highest(int *prio) {
+    for (int p = 0; p < CTRL_PRIO_COUNT; p++) {
+        Ctrl_Node *n = q_pop(p);
+        if (n) { *prio = p; return n; }
+    }
+    return NULL;
+}
+
+// 풀이 비었을 때 더 낮은 우선순위 메시지 중 가장 오래된 것을 빼앗음
+static Ctrl_Node *q_steal_lower(int prio) {
+    for (int p = CTRL_PRIO_COUNT - 1; p > prio; p--) {
+        Ctrl_Node *n = q_pop(p);
+        if (n) {
+            g_stats[p].evicted++;
+            return n;
+        }
+    }
+    return NULL;
+}
+
+static void stats_record(int prio, uint64_t lat_ns) {
+    Ctrl_Prio_Stats *st = &g_stats[prio];
+    uint64_t us = lat_ns / 1000u;
+    st->sent++;
+    st->total_us += us;
+    if (us > st->max_us) st->max_us = us;
+}
+
+static void *sender_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_qlock);
+    while (1) {
+        int prio;
+        Ctrl_Node *n = q_pop_highest(&prio);
+        if (!n) {
+            if (g_closing) break;
+            pthread_cond_wait(&g_qcond, &g_qlock);
+            continue;
+        }
+        int closing = g_closing;
+        pthread_mutex_unlock(&g_qlock);
+
+        int ok = (ensure_connected() == 0 &&
+                  wait_writable(g_fd) == 0 &&
+                  // 구조체 그대로 전송 (pack(1)로 패딩 제거된 레이아웃)
+                  send_all(g_fd, &n->msg, sizeof(Ctrl_Message)) == 0);
+        if (!ok) close_fd(); // 끊겼으면 닫아두고 다음 메시지 때 재연결 시도
+        uint64_t done = now_ns();
+
+        pthread_mutex_lock(&g_qlock);
+        if (ok) {
+            stats_record(prio, done - n->enq_ns);
+        } else if (prio == CTRL_PRIO_ESTOP && !closing) {
+            // 비상정지는 버리지 않고 재연결될 때까지 맨 앞에서 재시도
+            q_push_front(prio, n);
+            pthread_mutex_unlock(&g_qlock);
+            struct timespec ts = { 0, CTRL_RETRY_MS * 1000000L };
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&g_qlock);
+            continue;
+        } else {
+            g_stats[prio].send_failed++;
+        }
+        n->next = g_free;
+        g_free = n;
+    }
+    pthread_mutex_unlock(&g_qlock);
+    return NULL;
+}
+
 int ctrl_client_init(const char *ip, uint16_t port) {
-    memset(&g_addr, 0, sizeof(g_addr));
-    g_addr.sin_family = AF_INET;
-    if (inet_pton(AF_INET, ip, &g_addr.sin_addr) != 1) return -1;
-    g_addr.sin_port   = htons(port);
-    return ensure_connected(); 
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    addr.sin_port   = htons(port);
+
+    if (g_running) {
+        // 송신 스레드가 g_addr로 재연결하므로 실행 중에는 목적지를 바꾸지 않음
+        if (addr.sin_addr.s_addr == g_addr.sin_addr.s_addr && addr.sin_port == g_addr.sin_port) return 0;
+        errno = EISCONN;
+        return -1;
+    }
+    g_addr = addr;
+
+    pthread_mutex_lock(&g_qlock);
+    if (!g_pool_ready) pool_init();
+    g_closing = 0;
+    pthread_mutex_unlock(&g_qlock);
+
+    // 연결에 실패해도 송신 스레드는 띄워 둠 (다음 메시지 때 재연결 시도)
+    (void)ensure_connected();
+    if (pthread_create(&g_thread, NULL, sender_thread, NULL) != 0) {
+        close_fd();
+        return -1;
+    }
+    g_running = 1;
+    return 0;
 }
 
 void ctrl_client_close(void) {
-    if (g_fd >= 0) {
-        close(g_fd);
-        g_fd = -1;
+    if (g_running) {
+        // 큐에 남은 메시지는 보내고 종료
+        pthread_mutex_lock(&g_qlock);
+        g_closing = 1;
+        pthread_cond_signal(&g_qcond);
+        pthread_mutex_unlock(&g_qlock);
+        pthread_join(g_thread, NULL);
+        g_running = 0;
     }
+    close_fd();
 }
 
 int ctrl_send_message(const Ctrl_Message *msg) {
-    if (!msg) return -1;
-    if (ensure_connected() != 0) return -1;
+    if (!msg || !g_running) return -1;
+
+    int prio = ctrl_cmd_priority(msg->cmd);
 
-    // 구조체 그대로 전송 (pack(1)로 패딩 제거된 레이아웃)
-    if (send_all(g_fd, msg, sizeof(Ctrl_Message)) != 0) {
-        ctrl_client_close(); // 끊겼으면 닫아두고 다음 호출 때 재연결 시도
+    pthread_mutex_lock(&g_qlock);
+    Ctrl_Node *n = g_free;
+    if (n) {
+        g_free = n->next;
+    } else {
+        n = q_steal_lower(prio);
+    }
+    if (!n) {
+        // 같은/더 높은 우선순위로 가득 참
+        g_stats[prio].rejected++;
+        pthread_mutex_unlock(&g_qlock);
         return -1;
     }
+
+    n->msg = *msg;
+    n->enq_ns = now_ns();
+    q_push_back(prio, n);
+    pthread_cond_signal(&g_qcond);
+    pthread_mutex_unlock(&g_qlock);
     return 0;
 }
 
+void ctrl_get_prio_stats(int prio, Ctrl_Prio_Stats *out) {
+    if (!out || prio < 0 || prio >= CTRL_PRIO_COUNT) return;
+    pthread_mutex_lock(&g_qlock);
+    *out = g_stats[prio];
+    pthread_mutex_unlock(&g_qlock);
+}
+
 // ---- 편의 함수들 ----
 
 int ctrl_send_track_start(void) {
@@ -99,6 +315,22 @@ int ctrl_send_headlight(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness) {
     return ctrl_send_message(&m);
 }
 
+int ctrl_send_estop(void) {
+    Ctrl_Message m;
+    memset(&m, 0, sizeof(m));
+    m.cmd = CMD_ESTOP;
+    m.payload.estop_payload._dummy = 0;
+    return ctrl_send_message(&m);
+}
+
+int ctrl_send_estop_clear(void) {
+    Ctrl_Message m;
+    memset(&m, 0, sizeof(m));
+    m.cmd = CMD_ESTOP_CLEAR;
+    m.payload.estop_payload._dummy = 0;
+    return ctrl_send_message(&m);
+}
+
 int ctrl_send_laser(uint8_t on) {
     Ctrl_Message m;
     memset(&m, 0, sizeof(m));
@@ -119,14 +351,62 @@ int ctrl_send_laser(uint8_t on) {
 
 
 
+// 데모 main (다른 프로그램에 모듈로 링크할 때는 -DNO_DEMO_MAIN 으로 빌드)
+#ifndef NO_DEMO_MAIN
 #include <stdio.h>
+#include <stdlib.h>
 
-int main(void) {
-    if (ctrl_client_init("127.0.0.1", 8080) != 0) {
+// 헤드라이트 명령을 계속 밀어넣는 스레드 (우선순위 측정용)
+static void *flood_thread(void *arg) {
+    long count = *(const long *)arg;
+    for (long i = 0; i < count; i++) {
+        while (ctrl_send_headlight((uint8_t)i, 80, 0, 50) != 0) {
+            struct timespec ts = { 0, 100000L };  // 큐가 차면 잠깐 쉬고 재시도
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void print_stats(void) {
+    static const char *names[CTRL_PRIO_COUNT] = { "estop", "drive", "track", "cosmetic" };
+    for (int p = 0; p < CTRL_PRIO_COUNT; p++) {
+        Ctrl_Prio_Stats st;
+        ctrl_get_prio_stats(p, &st);
+        if (st.sent == 0 && st.rejected == 0 && st.evicted == 0 && st.send_failed == 0) continue;
+        printf("%-9s sent=%u lost=%u (evicted=%u send_failed=%u) rejected=%u avg=%.1f us max=%llu us\n",
+               names[p], st.sent, st.evicted + st.send_failed, st.evicted, st.send_failed, st.rejected,
+               st.sent ? (double)st.total_us / st.sent : 0.0,
+               (unsigned long long)st.max_us);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *ip  = (argc > 1) ? argv[1] : "127.0.0.1";
+    uint16_t    port = (argc > 2) ? (uint16_t)atoi(argv[2]) : 8080;
+    long        flood = (argc > 3) ? atol(argv[3]) : 0;   // 헤드라이트 flood 개수
+
+    if (ctrl_client_init(ip, port) != 0) {
         perror("ctrl_client_init");
         return 1;
     }
 
+    if (flood > 0) {
+        // 헤드라이트 flood 중에 5ms마다 비상정지를 넣어서 최악 지연 측정
+        pthread_t th;
+        pthread_create(&th, NULL, flood_thread, &flood);
+        for (int i = 0; i < 200; i++) {
+            ctrl_send_estop();
+            struct timespec ts = { 0, 5000000L };
+            nanosleep(&ts, NULL);
+        }
+        ctrl_send_estop_clear();   // 차량은 해제될 때까지 정지 상태를 유지하므로
+        pthread_join(th, NULL);
+        ctrl_client_close();
+        print_stats();
+        return 0;
+    }
+
     ctrl_send_track_start();
     ctrl_send_headlight(255, 80, 0, 50);
     ctrl_send_laser(1);
@@ -135,4 +415,5 @@ int main(void) {
 
     ctrl_client_close();
     return 0;
-}
\ No newline at end of file
+}
+#endif
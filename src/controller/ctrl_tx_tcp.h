@@ -3,10 +3,21 @@
 
 #include "ctrl_protocol.h"
 
+// 송신 스레드를 띄우고 연결 시도. 연결이 안 돼도 스레드가 떴으면 0 (보낼 때 재연결 시도)
+// -1: 주소 오류(EINVAL), 스레드 생성 실패, 또는 이미 다른 주소로 실행 중(EISCONN, 먼저 ctrl_client_close)
+// 같은 주소로 다시 부르면 아무것도 안 하고 0
 int  ctrl_client_init(const char *ip, uint16_t port);
 void ctrl_client_close(void);
 
 // "구조체 그대로" 전송 (sizeof(Ctrl_Message) 바이트)
+// 우선순위 큐에 넣고 바로 반환, 송신 스레드가 높은 우선순위부터 보냄 (ctrl_cmd_priority 참고)
+// 큐가 같은/더 높은 우선순위 메시지로 가득 차면 -1 (rejected, 호출자가 재시도 여부 결정)
+//
+// 주의: 0을 반환해도 전달이 보장되지는 않음.
+// - 큐가 가득 찬 상태에서 더 높은 우선순위 메시지가 들어오면, 아직 안 보낸 낮은 우선순위
+//   메시지 중 가장 오래된 것을 조용히 버리고 자리를 내줌 (evicted)
+// - 송신 중 연결이 끊기면 버림 (send_failed). 단 비상 정지/해제는 재연결될 때까지 재시도
+// 실제로 잃어버린 수는 ctrl_get_prio_stats()의 evicted + send_failed
 int  ctrl_send_message(const Ctrl_Message *msg);
 
 // 편의 함수들
@@ -14,5 +25,19 @@ int  ctrl_send_track_start(void);
 int  ctrl_send_track_stop(void);
 int  ctrl_send_headlight(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness);
 int  ctrl_send_laser(uint8_t on);
+int  ctrl_send_estop(void);
+int  ctrl_send_estop_clear(void);
+
+// 우선순위별 송신 통계 (큐에 넣은 시점 ~ 송신 완료까지)
+typedef struct {
+    uint32_t sent;
+    uint32_t rejected;    // 큐 포화로 ctrl_send_message()가 -1을 반환한 수 (큐에 안 들어감)
+    uint32_t evicted;     // 받아들인 뒤 더 높은 우선순위에 자리를 뺏겨 버려진 수
+    uint32_t send_failed; // 받아들인 뒤 연결 실패로 버린 수
+    uint64_t total_us;
+    uint64_t max_us;
+} Ctrl_Prio_Stats;
+
+void ctrl_get_prio_stats(int prio, Ctrl_Prio_Stats *out);
 
 #endif
\ No newline at end of file
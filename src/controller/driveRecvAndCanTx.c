@@ -1,11 +1,17 @@
 // driveRecvAndCanTx.c
+#include "clock_sync.h"
+#include "drive_protocol.h"
+
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 
@@ -15,12 +21,6 @@
 #include <net/if.h>
 #include <sys/ioctl.h>
 
-// UDP로 받은 big-endian int16을 host-endian int16으로 변환
-static int16_t parse_i16_be(const uint8_t b[2]) {
-    uint16_t u = ntohs(((uint16_t)b[0] << 8) | (uint16_t)b[1]);
-    return (int16_t)u;  // big-endian을 그대로 16비트로 조합하면, host에서 int16으로 해석 가능
-}
-
 // SocketCAN용 CAN 소켓 열기
 static int open_can_socket(const char *ifname) {
     int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
@@ -54,13 +54,295 @@ static int open_can_socket(const char *ifname) {
     return s;
 }
 
+// ==============================
+// CAN 출력 루프 (업샘플링 + 변화율 제한)
+// ==============================
+// UDP 명령은 20~50ms 간격으로 들어오므로, 그대로 CAN에 쓰면 모터/조향이 계단식으로 움직인다.
+// 별도 스레드가 고정 주기(기본 500Hz)로 돌면서 최신 목표값 쪽으로 조금씩 따라가며 CAN 프레임을 낸다.
+
+typedef struct {
+    uint32_t rate_hz;      // CAN 출력 주기 (Hz)
+    float    steer_slew;   // 조향 최대 변화율 (deg/s), 0이면 제한 없음
+    float    speed_slew;   // 속도 최대 변화율 (단위/s), 0이면 제한 없음
+    float    speed_accel;  // 속도 변화율의 최대 변화량 (단위/s^2), 0이면 제한 없음
+    uint32_t timeout_ms;   // 이 시간 동안 유효한 명령이 없으면 속도 0으로 감속 후 출력 중단, 0이면 끔
+} Shaper_Config;
+
+typedef struct {
+    int16_t steering;
+    uint8_t gear;   // 0=전진, 1=후진
+    uint8_t speed;
+} Drive_Target;
+
+static pthread_mutex_t g_target_lock = PTHREAD_MUTEX_INITIALIZER;
+static Drive_Target g_target = {0, 0, 0};
+static int g_have_target = 0;   // 첫 명령을 받기 전에는 CAN 출력 안 함
+static uint64_t g_target_rx_ns = 0;   // 마지막 유효 명령 수신 시각 (명령 타임아웃 판단용)
+
+// 비상 정지 (CAN_ID_ESTOP, socketReceiver가 TCP 명령을 CAN으로 전달)
+// 걸리면 해제(CMD_ESTOP_CLEAR)가 올 때까지 속도 0을 계속 내보내고 UDP 주행 입력은 무시
+static int g_estop = 0;
+static uint32_t g_estop_ignored = 0;  // 정지 중 무시한 주행 명령 수
+
+// 명령 -> CAN 출력 지연 측정 (컨트롤러 송신 시각이 있고 시계 offset을 알 때만)
+// 목표값이 바뀐 뒤 처음 나가는 CAN 프레임 시각 - 컨트롤러 송신 시각(내 시계로 환산)
+static uint64_t g_target_tx_local = 0;   // 0이면 측정 대상 아님
+static Lat_Hist g_act_hist;              // g_target_lock으로 보호
+
+static Clock_Sync g_clock;               // 컨트롤러가 probe로 알려준 offset/RTT
+
+static Shaper_Config g_shaper = { 500, 360.0f, 200.0f, 800.0f, 200 };
+static int g_canfd = -1;
+
+// 목표값 갱신 (수신 루프에서 호출)
+// tx_local: 이 명령의 컨트롤러 송신 시각(내 시계 기준), 모르면 0
+static void set_target(int16_t steering, uint8_t gear, uint8_t speed, uint64_t tx_local) {
+    pthread_mutex_lock(&g_target_lock);
+    if (g_estop) {
+        g_estop_ignored++;
+        pthread_mutex_unlock(&g_target_lock);
+        return;
+    }
+    if (g_target.steering != steering || g_target.gear != gear || g_target.speed != speed) {
+        g_target_tx_local = tx_local;
+    }
+    g_target.steering = steering;
+    g_target.gear     = gear;
+    g_target.speed    = speed;
+    g_have_target     = 1;
+    g_target_rx_ns    = clock_sync_now_ns();
+    pthread_mutex_unlock(&g_target_lock);
+}
+
+// cur를 target 쪽으로 최대 max_step만큼 이동 (max_step <= 0 이면 바로 target)
+static float step_toward(float cur, float target, float max_step) {
+    float d = target - cur;
+    if (max_step <= 0.0f || fabsf(d) <= max_step) return target;
+    return (d > 0.0f) ? cur + max_step : cur - max_step;
+}
+
+// 속도는 부호 있는 값(후진 = 음수)으로 다뤄서 기어 전환 시 0을 거쳐 감속 -> 반대 방향 가속이 되게 한다.
+// rate는 현재 속도 변화율(단위/s)이며 가속도 제한 적용 대상.
+static void step_velocity(float *v, float *rate, float target_v, float dt,
+                          const Shaper_Config *cfg) {
+    float err = target_v - *v;
+    float want = (cfg->speed_slew > 0.0f) ? cfg->speed_slew : fabsf(err) / dt;
+
+    if (cfg->speed_accel > 0.0f) {
+        // 남은 오차 안에서 멈출 수 있는 변화율까지만 허용 (오버슈트 방지)
+        float brake = sqrtf(2.0f * cfg->speed_accel * fabsf(err));
+        if (want > brake) want = brake;
+    }
+    if (err < 0.0f) want = -want;
+
+    if (cfg->speed_accel > 0.0f) {
+        *rate = step_toward(*rate, want, cfg->speed_accel * dt);
+    } else {
+        *rate = want;
+    }
+
+    float next = *v + *rate * dt;
+    // 목표를 지나쳤으면 목표에 딱 맞추고 정지
+    if ((err >= 0.0f && next >= target_v) || (err <= 0.0f && next <= target_v)) {
+        next  = target_v;
+        *rate = 0.0f;
+    }
+    *v = next;
+}
+
+static void timespec_add_ns(struct timespec *ts, long ns) {
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+static int timespec_before(const struct timespec *a, const struct timespec *b) {
+    if (a->tv_sec != b->tv_sec) return a->tv_sec < b->tv_sec;
+    return a->tv_nsec < b->tv_nsec;
+}
+
+static void *can_output_thread(void *arg) {
+    (void)arg;
+
+    const Shaper_Config *cfg = &g_shaper;
+    const long period_ns = 1000000000L / (long)cfg->rate_hz;
+    const float dt = (float)period_ns / 1e9f;
+    const uint64_t timeout_ns = (uint64_t)cfg->timeout_ms * 1000000ull;
+
+    float steer = 0.0f;      // 현재 출력 조향 (deg)
+    float vel   = 0.0f;      // 현재 출력 속도 (후진은 음수)
+    float rate  = 0.0f;      // 현재 속도 변화율
+    int   timed_out = 0;      // 명령 끊김 상태 (로그 한 번만)
+
+    struct can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id  = CAN_ID_DRIVE;   // ★ 0x123, 이 ID로 라즈3에서 필터 걸어서 받으면 됨
+    frame.can_dlc = 4;       // 데이터 길이 4바이트
+
+    // 절대 시각 기준 스케줄: 각 틱의 deadline = 시작 + k * period
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (1) {
+        timespec_add_ns(&next, period_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+
+        // 밀린 틱은 건너뛰되, 그만큼 적분 시간에 반영
+        uint32_t ticks = 1;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec late = next;
+        timespec_add_ns(&late, period_ns);
+        while (!timespec_before(&now, &late)) {
+            next = late;
+            timespec_add_ns(&late, period_ns);
+            ticks++;
+        }
+
+        Drive_Target tgt;
+        int have, estop;
+        uint64_t tx_local, rx_ns;
+        pthread_mutex_lock(&g_target_lock);
+        tgt  = g_target;
+        have = g_have_target;
+        estop = g_estop;
+        rx_ns = g_target_rx_ns;
+        tx_local = g_target_tx_local;
+        g_target_tx_local = 0;
+        pthread_mutex_unlock(&g_target_lock);
+
+        if (estop) {
+            // 램프 없이 바로 0, 해제될 때까지 매 틱 정지 프레임 유지
+            vel  = 0.0f;
+            rate = 0.0f;
+            Drive_Payload out = { (int16_t)lrintf(steer), tgt.gear, 0 };
+            drive_state_encode(frame.data, &out);
+            ssize_t wn = write(g_canfd, &frame, sizeof(frame));
+            if (wn != (ssize_t)sizeof(frame) && errno != ENOBUFS) perror("write(can)");
+            continue;
+        }
+        if (!have) continue;
+
+        // 명령 타임아웃: 컨트롤러가 죽거나 링크가 끊기면 마지막 명령으로 계속 달리지 않도록
+        // 속도 목표를 0으로 바꿔 감속하고, 멈춘 뒤에는 CAN 출력을 끊어 차량측도 알 수 있게 함
+        int stale = timeout_ns && clock_sync_now_ns() - rx_ns > timeout_ns;
+        if (stale != timed_out) {
+            timed_out = stale;
+            if (stale) printf("[TIMEOUT] no drive command for %u ms, stopping\n", cfg->timeout_ms);
+            else       printf("[TIMEOUT] drive command resumed\n");
+            fflush(stdout);
+        }
+        if (stale && vel == 0.0f) continue;
+
+        float target_v = stale ? 0.0f : (tgt.gear == 1) ? -(float)tgt.speed : (float)tgt.speed;
+        float step_dt = dt * (float)ticks;
+        steer = step_toward(steer, (float)tgt.steering, cfg->steer_slew * step_dt);
+        step_velocity(&vel, &rate, target_v, step_dt, cfg);
+
+        int16_t out_steer = (int16_t)lrintf(steer);
+        long    out_speed = lrintf(fabsf(vel));
+        uint8_t out_gear  = (vel < 0.0f) ? 1 : (vel > 0.0f) ? 0 : tgt.gear;
+        if (out_speed > 255) out_speed = 255;
+
+        // UDP로 받던 4바이트와 같은 레이아웃
+        Drive_Payload out = { out_steer, out_gear, (uint8_t)out_speed };
+        drive_state_encode(frame.data, &out);
+
+        ssize_t wn = write(g_canfd, &frame, sizeof(frame));
+        if (wn != (ssize_t)sizeof(frame) && errno != ENOBUFS) {
+            perror("write(can)");
+        }
+
+        if (tx_local) {
+            uint64_t done = clock_sync_now_ns();
+            pthread_mutex_lock(&g_target_lock);
+            if (done > tx_local) lat_hist_add(&g_act_hist, done - tx_local);
+            pthread_mutex_unlock(&g_target_lock);
+        }
+    }
+    return NULL;
+}
+
+// CAN_ID_ESTOP 수신: data[0]은 명령 코드 (socketReceiver가 Ctrl_Message 그대로 전달)
+// 해제 명령이 아니면 모두 정지로 취급
+static void *estop_thread(void *arg) {
+    int fd = *(int *)arg;
+    struct can_frame f;
+
+    while (1) {
+        ssize_t n = read(fd, &f, sizeof(f));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("read(can estop)");
+            break;
+        }
+        if (n != (ssize_t)sizeof(f) || (f.can_id & CAN_SFF_MASK) != CAN_ID_ESTOP) continue;
+
+        int clear = (f.can_dlc >= 1 && f.data[0] == CMD_ESTOP_CLEAR);
+        pthread_mutex_lock(&g_target_lock);
+        int was = g_estop;
+        uint32_t ignored = g_estop_ignored;
+        if (clear) {
+            g_estop = 0;
+            g_have_target = 0;    // 해제 후에는 새 주행 명령부터 다시 따라감
+        } else {
+            g_estop = 1;
+            g_estop_ignored = 0;
+        }
+        pthread_mutex_unlock(&g_target_lock);
+
+        if (clear && was)  printf("[ESTOP] cleared (%u drive commands ignored while stopped)\n", ignored);
+        if (!clear && !was) printf("[ESTOP] engaged, holding speed 0 until ESTOP_CLEAR\n");
+        fflush(stdout);
+    }
+    return NULL;
+}
+
+static void print_latency(void) {
+    int64_t  off;
+    uint64_t rtt;
+    if (!clock_sync_get(&g_clock, &off, &rtt)) return;
+
+    pthread_mutex_lock(&g_target_lock);
+    Lat_Hist h = g_act_hist;
+    pthread_mutex_unlock(&g_target_lock);
+
+    printf("[CLOCK] offset(ctrl-car)=%lld us rtt=%.1f us | cmd->CAN n=%u p50=%.1f p99=%.1f max=%.1f us\n",
+           (long long)(off / 1000), rtt / 1e3, h.count,
+           lat_hist_percentile(&h, 50.0) / 1e3, lat_hist_percentile(&h, 99.0) / 1e3,
+           h.max_ns / 1e3);
+}
+
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <listen_port>\n", argv[0]);
+    // CAN 인터페이스 (기본 can0, 시뮬레이터는 -i vcanN)
+    const char *can_ifname = "can0";
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "i:t:")) != -1) {
+        if (opt == 'i')      can_ifname = optarg;
+        else if (opt == 't') g_shaper.timeout_ms = (uint32_t)atoi(optarg);
+        else                 bad = 1;
+    }
+    int nargs = argc - optind;
+    if (bad || nargs < 1 || nargs > 5) {
+        fprintf(stderr,
+                "Usage: %s [-i can_ifname] [-t cmd_timeout_ms] <listen_port> [rate_hz] [steer_slew_deg_s] "
+                "[speed_slew_per_s] [speed_accel_per_s2]\n", argv[0]);
         return 1;
     }
+    char **args = argv + optind;
 
-    int port = atoi(argv[1]);
+    int port = atoi(args[0]);
+    if (nargs > 1) g_shaper.rate_hz     = (uint32_t)atoi(args[1]);
+    if (nargs > 2) g_shaper.steer_slew  = (float)atof(args[2]);
+    if (nargs > 3) g_shaper.speed_slew  = (float)atof(args[3]);
+    if (nargs > 4) g_shaper.speed_accel = (float)atof(args[4]);
+    if (g_shaper.rate_hz == 0 || g_shaper.rate_hz > 10000) {
+        fprintf(stderr, "rate_hz must be 1..10000\n");
+        return 1;
+    }
 
     // 1) UDP 소켓 생성
     int fd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -86,9 +368,9 @@ int main(int argc, char **argv) {
 
     printf("UDP receiver listening on 0.0.0.0:%d\n", port);
     printf("Expecting 4 bytes: steering(int16 BE) + gear(uint8) + speed(uint8)\n");
+    printf("             or redundant: magic + seq + count + epoch + count * 4 bytes\n");
 
-    // 2) CAN 소켓 생성 (예: can0)
-    const char *can_ifname = "can0";   // 필요하면 "can1" 등으로 수정
+    // 2) CAN 소켓 생성
     int canfd = open_can_socket(can_ifname);
     if (canfd < 0) {
         fprintf(stderr, "Failed to open CAN interface %s\n", can_ifname);
@@ -96,57 +378,108 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    printf("CAN sender using interface %s\n", can_ifname);
-    printf("Forwarding received UDP payload (4 bytes) as CAN frame data (ID=0x123)\n");
+    printf("CAN sender using interface %s | cmd timeout %u ms%s\n",
+           can_ifname, g_shaper.timeout_ms, g_shaper.timeout_ms ? "" : " (off)");
+    printf("Output loop %u Hz | steer slew %.1f deg/s | speed slew %.1f/s | accel %.1f/s^2 (ID=0x%03X)\n",
+           g_shaper.rate_hz, g_shaper.steer_slew, g_shaper.speed_slew, g_shaper.speed_accel,
+           CAN_ID_DRIVE);
+
+    // 비상 정지 수신용 소켓 (ESTOP ID만 받음)
+    int estop_fd = open_can_socket(can_ifname);
+    if (estop_fd < 0) {
+        close(canfd);
+        close(fd);
+        return 1;
+    }
+    struct can_filter estop_filt = { CAN_ID_ESTOP, CAN_SFF_MASK };
+    setsockopt(estop_fd, SOL_CAN_RAW, CAN_RAW_FILTER, &estop_filt, sizeof(estop_filt));
+    pthread_t es_thread;
+    if (pthread_create(&es_thread, NULL, estop_thread, &estop_fd) != 0) {
+        perror("pthread_create");
+        close(estop_fd);
+        close(canfd);
+        close(fd);
+        return 1;
+    }
+
+    g_canfd = canfd;
+    pthread_t out_thread;
+    if (pthread_create(&out_thread, NULL, can_output_thread, NULL) != 0) {
+        perror("pthread_create");
+        close(canfd);
+        close(fd);
+        return 1;
+    }
+
+    Drive_Dedup dedup;
+    memset(&dedup, 0, sizeof(dedup));
+    clock_sync_init(&g_clock);
+    uint64_t last_report = clock_sync_now_ns();
 
     while (1) {
-        uint8_t buf[4];
+        uint8_t buf[DRIVE_PKT_MAX_LEN + DRIVE_PROBE_PING_LEN];
         struct sockaddr_in src;
         socklen_t slen = sizeof(src);
 
         ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&src, &slen);
+        uint64_t rx_ns = clock_sync_now_ns();
         if (n < 0) {
             if (errno == EINTR) continue;
             perror("recvfrom");
             break;
         }
-        if (n != 4) {
+
+        if (rx_ns - last_report >= 5000000000ull) {
+            print_latency();
+            last_report = rx_ns;
+        }
+
+        Drive_Probe pr;
+        if (drive_probe_parse(buf, (long)n, &pr) == 0) {
+            clock_sync_answer_ping(&g_clock, fd, &pr, rx_ns, &src);
+            continue;
+        }
+
+        Drive_Packet pkt;
+        if (drive_packet_parse(buf, (long)n, &pkt) != 0) {
             char ipbuf[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &src.sin_addr, ipbuf, sizeof(ipbuf));
-            printf("[WARN] got %zd bytes from %s:%u (expected 4)\n",
+            printf("[WARN] got %zd bytes from %s:%u (bad drive packet)\n",
                    n, ipbuf, ntohs(src.sin_port));
             continue;
         }
 
-        int16_t steering = parse_i16_be(&buf[0]);
-        uint8_t gear     = buf[2];
-        uint8_t speed    = buf[3];
+        // 중복 전송 모드: 다른 경로로 이미 받은 패킷이면 무시.
+        // 출력 루프가 최신 목표값만 따라가므로 복구된 이전 상태는 통계로만 남김
+        if (drive_dedup_accept(&dedup, &pkt) == 0) continue;
+
+        int16_t steering = pkt.states[0].steering_deg;
+        uint8_t gear     = pkt.states[0].gear;
+        uint8_t speed    = pkt.states[0].speed;
 
         char ipbuf[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &src.sin_addr, ipbuf, sizeof(ipbuf));
 
-        printf("from %s:%u | steering=%d deg | gear=%u | speed=%u\n",
-               ipbuf, ntohs(src.sin_port), steering, gear, speed);
-
-        // ==============================
-        // 여기서 CAN 프레임으로 그대로 송신
-        // ==============================
-        struct can_frame frame;
-        memset(&frame, 0, sizeof(frame));
-
-        frame.can_id  = 0x123;   // ★ 이 ID로 라즈3에서 필터 걸어서 받으면 됨
-        frame.can_dlc = 4;       // 데이터 길이 4바이트
-
-        // UDP에서 받은 4바이트를 그대로 CAN data로 복사
-        memcpy(frame.data, buf, 4);
+        // 송신 시각이 있으면 내 시계로 환산해서 명령 나이(단방향 지연) 계산
+        uint64_t tx_local = 0;
+        if (pkt.has_tx_ns && clock_sync_get(&g_clock, NULL, NULL)) {
+            tx_local = clock_sync_to_local(&g_clock, pkt.tx_ns);
+        }
 
-        ssize_t wn = write(canfd, &frame, sizeof(frame));
-        if (wn != (ssize_t)sizeof(frame)) {
-            perror("write(can)");
-            // 계속 돌리려면 break 대신 continue도 가능
+        if (tx_local) {
+            printf("from %s:%u | steering=%d deg | gear=%u | speed=%u | age=%.2f ms\n",
+                   ipbuf, ntohs(src.sin_port), steering, gear, speed,
+                   (double)(int64_t)(rx_ns - tx_local) / 1e6);
+        } else {
+            printf("from %s:%u | steering=%d deg | gear=%u | speed=%u\n",
+                   ipbuf, ntohs(src.sin_port), steering, gear, speed);
         }
+
+        // CAN 송신은 출력 루프가 담당, 여기서는 목표값만 갱신
+        set_target(steering, gear, speed, tx_local);
     }
 
+    close(estop_fd);
     close(canfd);
     close(fd);
     return 0;
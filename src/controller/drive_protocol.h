@@ -0,0 +1,294 @@
+#ifndef __DRIVE_PROTOCOL_H__
+#define __DRIVE_PROTOCOL_H__
+
+#include "ctrl_protocol.h"
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <string.h>
+
+// 주행 UDP 패킷 포맷
+//
+// 1) 기본 (4 bytes)
+//    steering(int16 BE) + gear(uint8) + speed(uint8)
+//    steering 인코딩은 기존 build_packet / parse_i16_be 와 동일하게 유지
+//    (htons 후 상위 바이트부터 기록, 수신측이 그대로 CAN data로 복사하므로 바꾸면 안 됨)
+//
+// 2) 중복 전송 모드 (5 + 4*count bytes)
+//    magic(0xD5) + seq(uint16 BE) + count(uint8) + epoch(uint8) + 상태 count개
+//    상태는 최신 것부터: seq, seq-1, ..., seq-count+1
+//    -> 패킷 하나가 유실돼도 다음 패킷에 이전 상태가 같이 실려 옴
+//    epoch는 송신 프로세스가 시작할 때 한 번 정하는 값. 바뀌면 수신측은 송신측 재시작으로 보고
+//    seq 비교를 처음부터 다시 함 (송신 주기와 무관하게 재시작을 구분)
+//    magic이 0xD7이면 헤더 뒤에 송신 시각 tx_ns(uint64 BE, 컨트롤러 CLOCK_MONOTONIC)가 붙음
+//    (clock probe로 offset을 알면 차량에서 명령 나이를 계산 가능)
+//
+// 3) 시계 probe (같은 포트로 다중화, clock_sync.h 참고)
+//    PING 컨트롤러->차량: magic(0xD6) + type(1) + id(uint16 BE) + t1 + offset + rtt + last_rtt + valid(1)
+//                         + sample_no(uint32 BE, last_rtt가 몇 번째 샘플인지: 같으면 새 샘플 없음)
+//    PONG 차량->컨트롤러: magic(0xD6) + type(2) + id(uint16 BE) + t1 + t2 + t3
+//    시각/offset은 모두 64bit BE (ns)
+//
+// 기본 포맷은 정확히 4 bytes, 나머지는 첫 바이트(magic)로 구분
+
+#define DRIVE_STATE_LEN    4
+#define DRIVE_RED_MAGIC    0xD5
+#define DRIVE_RED_TS_MAGIC 0xD7
+#define DRIVE_RED_HDR_LEN  5
+#define DRIVE_RED_TS_LEN   8
+#define DRIVE_RED_MAX_K    8
+#define DRIVE_PKT_MAX_LEN  (DRIVE_RED_HDR_LEN + DRIVE_RED_TS_LEN + DRIVE_RED_MAX_K * DRIVE_STATE_LEN)
+
+#define DRIVE_PROBE_MAGIC    0xD6
+#define DRIVE_PROBE_PING     1
+#define DRIVE_PROBE_PONG     2
+#define DRIVE_PROBE_PING_LEN 41
+#define DRIVE_PROBE_PONG_LEN 28
+
+static inline void drive_put_u64(uint8_t *out, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        out[i] = (uint8_t)(v & 0xFF);
+        v >>= 8;
+    }
+}
+
+static inline uint64_t drive_get_u64(const uint8_t *in) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | in[i];
+    return v;
+}
+
+static inline void drive_state_encode(uint8_t out[DRIVE_STATE_LEN], const Drive_Payload *s) {
+    uint16_t u = htons((uint16_t)s->steering_deg); // 음수도 2's complement 그대로 전송됨
+    out[0] = (uint8_t)((u >> 8) & 0xFF);
+    out[1] = (uint8_t)(u & 0xFF);
+    out[2] = s->gear;
+    out[3] = s->speed;
+}
+
+static inline Drive_Payload drive_state_decode(const uint8_t in[DRIVE_STATE_LEN]) {
+    Drive_Payload s;
+    s.steering_deg = (int16_t)ntohs(((uint16_t)in[0] << 8) | (uint16_t)in[1]);
+    s.gear  = in[2];
+    s.speed = in[3];
+    return s;
+}
+
+// 수신 패킷 파싱 결과
+typedef struct {
+    int         redundant;   // 0=기본 포맷, 1=중복 전송 포맷
+    uint16_t    seq;         // 최신 상태의 시퀀스 (기본 포맷이면 0)
+    uint8_t     epoch;       // 송신측 실행마다 바뀌는 값 (기본 포맷이면 0)
+    int         has_tx_ns;   // 송신 시각 포함 여부
+    uint64_t    tx_ns;       // 컨트롤러 시계 기준 송신 시각
+    uint8_t     count;       // 실린 상태 개수
+    Drive_Payload states[DRIVE_RED_MAX_K]; // [0]이 최신
+} Drive_Packet;
+
+// 성공 0, 형식 오류 -1
+static inline int drive_packet_parse(const uint8_t *buf, long len, Drive_Packet *p) {
+    if (len == DRIVE_STATE_LEN) {
+        p->redundant = 0;
+        p->seq = 0;
+        p->epoch = 0;
+        p->has_tx_ns = 0;
+        p->tx_ns = 0;
+        p->count = 1;
+        p->states[0] = drive_state_decode(buf);
+        return 0;
+    }
+    if (len < DRIVE_RED_HDR_LEN + DRIVE_STATE_LEN) return -1;
+    if (buf[0] != DRIVE_RED_MAGIC && buf[0] != DRIVE_RED_TS_MAGIC) return -1;
+
+    int has_ts = (buf[0] == DRIVE_RED_TS_MAGIC);
+    long hdr = DRIVE_RED_HDR_LEN + (has_ts ? DRIVE_RED_TS_LEN : 0);
+    uint8_t count = buf[3];
+    if (count == 0 || count > DRIVE_RED_MAX_K) return -1;
+    if (len != hdr + (long)count * DRIVE_STATE_LEN) return -1;
+
+    p->redundant = 1;
+    p->seq = (uint16_t)(((uint16_t)buf[1] << 8) | (uint16_t)buf[2]);
+    p->epoch = buf[4];
+    p->has_tx_ns = has_ts;
+    p->tx_ns = has_ts ? drive_get_u64(buf + DRIVE_RED_HDR_LEN) : 0;
+    p->count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        p->states[i] = drive_state_decode(buf + hdr + i * DRIVE_STATE_LEN);
+    }
+    return 0;
+}
+
+// ---- 시계 probe ----
+
+typedef struct {
+    uint8_t  type;        // DRIVE_PROBE_PING / DRIVE_PROBE_PONG
+    uint16_t id;
+    uint64_t t1;
+    // PING: 컨트롤러의 현재 추정값 (차량이 그대로 채택)
+    int64_t  offset_ns;
+    uint64_t rtt_ns;
+    uint64_t last_rtt_ns;
+    uint8_t  valid;
+    uint32_t sample_no;
+    // PONG
+    uint64_t t2;
+    uint64_t t3;
+} Drive_Probe;
+
+static inline long drive_probe_build_ping(uint8_t *out, uint16_t id, uint64_t t1, int valid,
+                                          int64_t offset_ns, uint64_t rtt_ns, uint64_t last_rtt_ns,
+                                          uint32_t sample_no) {
+    out[0] = DRIVE_PROBE_MAGIC;
+    out[1] = DRIVE_PROBE_PING;
+    out[2] = (uint8_t)(id >> 8);
+    out[3] = (uint8_t)(id & 0xFF);
+    drive_put_u64(out + 4,  t1);
+    drive_put_u64(out + 12, (uint64_t)offset_ns);
+    drive_put_u64(out + 20, rtt_ns);
+    drive_put_u64(out + 28, last_rtt_ns);
+    out[36] = (uint8_t)(valid ? 1 : 0);
+    out[37] = (uint8_t)(sample_no >> 24);
+    out[38] = (uint8_t)(sample_no >> 16);
+    out[39] = (uint8_t)(sample_no >> 8);
+    out[40] = (uint8_t)(sample_no & 0xFF);
+    return DRIVE_PROBE_PING_LEN;
+}
+
+// t3는 송신 직전에 채워야 하므로 호출자가 마지막에 호출
+static inline long drive_probe_build_pong(uint8_t *out, uint16_t id,
+                                          uint64_t t1, uint64_t t2, uint64_t t3) {
+    out[0] = DRIVE_PROBE_MAGIC;
+    out[1] = DRIVE_PROBE_PONG;
+    out[2] = (uint8_t)(id >> 8);
+    out[3] = (uint8_t)(id & 0xFF);
+    drive_put_u64(out + 4,  t1);
+    drive_put_u64(out + 12, t2);
+    drive_put_u64(out + 20, t3);
+    return DRIVE_PROBE_PONG_LEN;
+}
+
+// probe 패킷이면 0, 아니면 -1
+static inline int drive_probe_parse(const uint8_t *buf, long len, Drive_Probe *p) {
+    if (len < 4 || buf[0] != DRIVE_PROBE_MAGIC) return -1;
+
+    memset(p, 0, sizeof(*p));
+    p->type = buf[1];
+    p->id = (uint16_t)(((uint16_t)buf[2] << 8) | (uint16_t)buf[3]);
+
+    if (p->type == DRIVE_PROBE_PING && len == DRIVE_PROBE_PING_LEN) {
+        p->t1          = drive_get_u64(buf + 4);
+        p->offset_ns   = (int64_t)drive_get_u64(buf + 12);
+        p->rtt_ns      = drive_get_u64(buf + 20);
+        p->last_rtt_ns = drive_get_u64(buf + 28);
+        p->valid       = buf[36];
+        p->sample_no   = ((uint32_t)buf[37] << 24) | ((uint32_t)buf[38] << 16) |
+                         ((uint32_t)buf[39] << 8) | (uint32_t)buf[40];
+        return 0;
+    }
+    if (p->type == DRIVE_PROBE_PONG && len == DRIVE_PROBE_PONG_LEN) {
+        p->t1 = drive_get_u64(buf + 4);
+        p->t2 = drive_get_u64(buf + 12);
+        p->t3 = drive_get_u64(buf + 20);
+        return 0;
+    }
+    return -1;
+}
+
+// ---- 차량 상태 프레임 (CAN_ID_STATUS) ----
+// v(cm/s) + heading(0.01deg) + x(cm) + y(cm), 각각 int16 BE
+// speed 명령(0~255)과 실제 속도의 관계는 DRIVE_SPEED_FULL_MPS 기준 선형 (시뮬레이터 모델)
+
+#define DRIVE_STATUS_LEN     8
+#define DRIVE_SPEED_FULL_MPS 3.0f   // speed=255 일 때 속도 (m/s)
+
+typedef struct {
+    float v_mps;        // 후진은 음수
+    float heading_deg;  // -180 ~ 180
+    float x_m;
+    float y_m;
+} Drive_Status;
+
+static inline void drive_put_i16_scaled(uint8_t *out, float v, float scale) {
+    float f = v * scale;
+    int32_t i = (int32_t)(f >= 0.0f ? f + 0.5f : f - 0.5f);
+    if (i >  32767) i =  32767;
+    if (i < -32768) i = -32768;
+    uint16_t u = (uint16_t)(int16_t)i;
+    out[0] = (uint8_t)(u >> 8);
+    out[1] = (uint8_t)(u & 0xFF);
+}
+
+static inline float drive_get_i16_scaled(const uint8_t *in, float scale) {
+    int16_t i = (int16_t)(((uint16_t)in[0] << 8) | (uint16_t)in[1]);
+    return (float)i / scale;
+}
+
+static inline void drive_status_encode(uint8_t out[DRIVE_STATUS_LEN], const Drive_Status *st) {
+    drive_put_i16_scaled(out + 0, st->v_mps, 100.0f);
+    drive_put_i16_scaled(out + 2, st->heading_deg, 100.0f);
+    drive_put_i16_scaled(out + 4, st->x_m, 100.0f);
+    drive_put_i16_scaled(out + 6, st->y_m, 100.0f);
+}
+
+static inline Drive_Status drive_status_decode(const uint8_t in[DRIVE_STATUS_LEN]) {
+    Drive_Status st;
+    st.v_mps       = drive_get_i16_scaled(in + 0, 100.0f);
+    st.heading_deg = drive_get_i16_scaled(in + 2, 100.0f);
+    st.x_m         = drive_get_i16_scaled(in + 4, 100.0f);
+    st.y_m         = drive_get_i16_scaled(in + 6, 100.0f);
+    return st;
+}
+
+// ---- 수신측 중복 제거 ----
+// 같은 패킷이 두 경로로 오거나, 이전 상태가 다음 패킷에 다시 실려 와도 한 번만 처리
+//
+// 송신측이 재시작하면 seq가 0부터 다시 시작하므로, 이전 seq보다 뒤로 보이는 새 스트림을
+// 중복으로 버리게 된다. 그래서 헤더의 epoch가 바뀌면 이전 seq를 잊고 새 스트림으로 받는다.
+// (시간 공백으로 판단하면 송신 주기가 그보다 긴 경우 매 패킷마다 초기화되어 유실 집계가 깨짐)
+
+typedef struct {
+    int      have;
+    uint16_t last_seq;
+    uint8_t  epoch;      // 현재 스트림의 송신측 epoch
+    uint32_t accepted;   // 새 시퀀스로 인정된 패킷 수
+    uint32_t duplicate;  // 중복으로 버린 패킷 수
+    uint32_t recovered;  // 유실됐지만 다음 패킷의 이력으로 복구한 상태 수
+    uint32_t lost;       // 이력으로도 복구 못 한 상태 수
+    uint32_t resets;     // 송신측 재시작(epoch 변경)으로 새 스트림을 시작한 횟수
+} Drive_Dedup;
+
+// 패킷에서 새로 반영할 상태 개수를 반환 (0이면 중복).
+// 새 상태는 p->states[0 .. n-1] (0이 최신).
+static inline int drive_dedup_accept(Drive_Dedup *d, const Drive_Packet *p) {
+    if (!p->redundant) {
+        d->accepted++;
+        return 1;
+    }
+    if (d->have && p->epoch != d->epoch) {
+        d->have = 0;
+        d->resets++;
+    }
+    if (!d->have) {
+        d->have = 1;
+        d->last_seq = p->seq;
+        d->epoch = p->epoch;
+        d->accepted++;
+        return 1;
+    }
+
+    int16_t diff = (int16_t)(uint16_t)(p->seq - d->last_seq);
+    if (diff <= 0 && diff > -1024) {
+        d->duplicate++;
+        return 0;
+    }
+    if (diff <= 0) diff = 1; // 송신측 재시작으로 보고 새로 시작
+
+    int fresh = (diff < p->count) ? diff : p->count;
+    d->recovered += (uint32_t)(fresh - 1);
+    d->lost      += (uint32_t)(diff - fresh);
+    d->accepted++;
+    d->last_seq = p->seq;
+    return fresh;
+}
+
+#endif
@@ -1,12 +1,16 @@
 #define _POSIX_C_SOURCE 200809L
 #include "drive_tx_udp.h"
+#include "clock_sync.h"
+#include "drive_protocol.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -20,6 +24,39 @@ static int g_running = 0;
 static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
 static Drive_Payload g_state = {0, 0, 0};
 
+// ---- 중복 전송 모드 ----
+// k > 0 이면 매 패킷에 최근 k개 상태 + 시퀀스를 실어 보냄 (0이면 기존 4바이트 포맷)
+static uint8_t  g_red_k = 0;
+static uint16_t g_seq = 0;
+static uint8_t  g_epoch = 0;   // 실행마다 바뀌는 값, 수신측이 재시작을 구분하는 데 사용
+static Drive_Payload g_hist[DRIVE_RED_MAX_K];   // g_hist[0]이 최신
+static uint8_t  g_hist_len = 0;
+
+// 보조 목적지 (다른 주소/인터페이스로 같은 패킷을 한 번 더 보냄)
+static struct sockaddr_in g_alt_dest;
+static int g_have_alt = 0;
+
+// ---- 유실 주입 (테스트용, Gilbert-Elliott 버스트 모델) ----
+typedef struct {
+    double   p_enter_bad;  // good -> bad 전이 확률
+    double   p_leave_bad;  // bad -> good 전이 확률
+    int      bad;
+    unsigned seed;
+    uint32_t dropped;
+} Loss_Sim;
+
+static int g_loss_on = 0;
+static Loss_Sim g_loss[2];    // [0]=기본 목적지, [1]=보조 목적지 (서로 독립)
+static uint32_t g_sent = 0;
+
+// ---- 시계 probe ----
+// probe_ms마다 PING을 보내고 차량의 PONG으로 offset/RTT 추정 (clock_sync.h)
+// 켜져 있으면 주행 패킷에도 송신 시각을 실음 (차량에서 명령 나이 계산용)
+static uint32_t g_probe_ms = 0;
+static uint16_t g_probe_id = 0;
+static pthread_t g_probe_thread;
+static Clock_Sync g_clock;
+
 static void sleep_ms(uint32_t ms) {
     struct timespec ts;
     ts.tv_sec  = (time_t)(ms / 1000);
@@ -29,32 +66,132 @@ static void sleep_ms(uint32_t ms) {
 
 static void build_packet(uint8_t out[4], const Drive_Payload *s) {
     // wire format: steering(int16 BE) + gear + speed => 4 bytes
-    uint16_t be = htons((uint16_t)s->steering_deg); // 음수도 2's complement 그대로 전송됨
-    out[0] = (uint8_t)((be >> 8) & 0xFF);
-    out[1] = (uint8_t)(be & 0xFF);
-    out[2] = s->gear;
-    out[3] = s->speed;
+    drive_state_encode(out, s);
+}
+
+// 중복 전송 포맷: magic + seq + count + epoch + [tx_ns] + 최근 상태들 (drive_protocol.h 참고)
+static size_t build_red_packet(uint8_t out[DRIVE_PKT_MAX_LEN], uint16_t seq,
+                               const Drive_Payload *hist, uint8_t count,
+                               int with_ts, uint64_t tx_ns) {
+    size_t hdr = DRIVE_RED_HDR_LEN;
+    out[0] = with_ts ? DRIVE_RED_TS_MAGIC : DRIVE_RED_MAGIC;
+    out[1] = (uint8_t)(seq >> 8);
+    out[2] = (uint8_t)(seq & 0xFF);
+    out[3] = count;
+    out[4] = g_epoch;
+    if (with_ts) {
+        drive_put_u64(out + hdr, tx_ns);
+        hdr += DRIVE_RED_TS_LEN;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        drive_state_encode(out + hdr + i * DRIVE_STATE_LEN, &hist[i]);
+    }
+    return hdr + (size_t)count * DRIVE_STATE_LEN;
+}
+
+static void hist_push(const Drive_Payload *s, uint8_t k) {
+    if (k > DRIVE_RED_MAX_K) k = DRIVE_RED_MAX_K;
+    if (g_hist_len < k) g_hist_len++;
+    memmove(&g_hist[1], &g_hist[0], sizeof(g_hist[0]) * (size_t)(g_hist_len - 1));
+    g_hist[0] = *s;
+}
+
+// 1이면 이번 패킷을 버림
+static int loss_drop(Loss_Sim *l) {
+    double r = (double)rand_r(&l->seed) / ((double)RAND_MAX + 1.0);
+    if (l->bad) {
+        if (r < l->p_leave_bad) l->bad = 0;
+    } else {
+        if (r < l->p_enter_bad) l->bad = 1;
+    }
+    if (l->bad) l->dropped++;
+    return l->bad;
+}
+
+static void send_pkt(int path, const struct sockaddr_in *dest, const uint8_t *pkt, size_t len) {
+    if (g_loss_on && loss_drop(&g_loss[path])) return;
+
+    ssize_t n = sendto(g_sock, pkt, len, 0,
+                       (const struct sockaddr *)dest, sizeof(*dest));
+    if (n < 0) {
+        // 너무 시끄러우면 로그 제거/레이트리밋 해도 됨
+        perror("sendto");
+        return;
+    }
+    g_sent++;
+}
+
+static void send_probe(void) {
+    int64_t  off = 0;
+    uint64_t rtt = 0;
+    int valid = clock_sync_get(&g_clock, &off, &rtt);
+
+    pthread_mutex_lock(&g_clock.lock);
+    uint64_t last_rtt = g_clock.last_rtt_ns;
+    uint32_t samples  = g_clock.samples;
+    pthread_mutex_unlock(&g_clock.lock);
+
+    uint8_t pkt[DRIVE_PROBE_PING_LEN];
+    long len = drive_probe_build_ping(pkt, g_probe_id++, clock_sync_now_ns(),
+                                      valid, off, rtt, last_rtt, samples);
+    send_pkt(0, &g_dest, pkt, (size_t)len);
+}
+
+// 차량의 PONG 수신 스레드 (t4는 받자마자 기록)
+static void *probe_rx_thread(void *arg) {
+    (void)arg;
+
+    // 종료 시 g_running 확인을 위해 타임아웃
+    struct timeval tv = { 0, 200000 };
+    setsockopt(g_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    while (g_running) {
+        uint8_t buf[64];
+        ssize_t n = recv(g_sock, buf, sizeof(buf), 0);
+        uint64_t t4 = clock_sync_now_ns();
+        if (n < 0) continue;   // 타임아웃/EINTR
+
+        Drive_Probe pr;
+        if (drive_probe_parse(buf, (long)n, &pr) != 0 || pr.type != DRIVE_PROBE_PONG) continue;
+        clock_sync_add_sample(&g_clock, pr.t1, pr.t2, pr.t3, t4);
+    }
+    return NULL;
 }
 
 static void *sender_thread(void *arg) {
     (void)arg;
 
+    uint64_t last_probe = 0;
+
     while (g_running) {
+        if (g_probe_ms) {
+            uint64_t now = clock_sync_now_ns();
+            if (now - last_probe >= (uint64_t)g_probe_ms * 1000000u) {
+                send_probe();
+                last_probe = now;
+            }
+        }
+
         Drive_Payload snap;
         pthread_mutex_lock(&g_lock);
         snap = g_state;               // 상태 스냅샷
         pthread_mutex_unlock(&g_lock);
 
-        uint8_t pkt[4];
-        build_packet(pkt, &snap);
-
-        ssize_t n = sendto(g_sock, pkt, sizeof(pkt), 0,
-                           (struct sockaddr *)&g_dest, sizeof(g_dest));
-        if (n < 0) {
-            // 너무 시끄러우면 로그 제거/레이트리밋 해도 됨
-            perror("sendto");
+        uint8_t pkt[DRIVE_PKT_MAX_LEN];
+        size_t len;
+        if (g_red_k == 0 && g_probe_ms == 0) {
+            build_packet(pkt, &snap);
+            len = DRIVE_STATE_LEN;
+        } else {
+            // probe 사용 시에는 송신 시각을 싣기 위해 최소 1개 상태의 중복 전송 포맷 사용
+            hist_push(&snap, g_red_k ? g_red_k : 1);
+            len = build_red_packet(pkt, g_seq++, g_hist, g_hist_len,
+                                   g_probe_ms != 0, clock_sync_now_ns());
         }
 
+        send_pkt(0, &g_dest, pkt, len);
+        if (g_have_alt) send_pkt(1, &g_alt_dest, pkt, len);
+
         sleep_ms(g_period_ms);
     }
     return NULL;
@@ -73,6 +210,8 @@ int drive_udp_start(const char *dest_ip, uint16_t dest_port, uint32_t period_ms)
     if (g_sock < 0) return -1;
 
     g_period_ms = period_ms;
+    g_epoch = (uint8_t)((uint64_t)getpid() ^ clock_sync_now_ns());
+    clock_sync_init(&g_clock);
     g_running = 1;
 
     if (pthread_create(&g_thread, NULL, sender_thread, NULL) != 0) {
@@ -81,14 +220,80 @@ int drive_udp_start(const char *dest_ip, uint16_t dest_port, uint32_t period_ms)
         g_sock = -1;
         return -1;
     }
+    if (g_probe_ms && pthread_create(&g_probe_thread, NULL, probe_rx_thread, NULL) != 0) {
+        g_running = 0;
+        pthread_join(g_thread, NULL);
+        close(g_sock);
+        g_sock = -1;
+        return -1;
+    }
     return 0;
 }
 
+int drive_udp_set_probe(uint32_t interval_ms) {
+    if (g_running) return -1;
+    g_probe_ms = interval_ms;
+    return 0;
+}
+
+int drive_udp_get_clock(int64_t *offset_ns, uint64_t *rtt_ns) {
+    if (!g_probe_ms) return 0;
+    return clock_sync_get(&g_clock, offset_ns, rtt_ns);
+}
+
+uint64_t drive_udp_rtt_percentile(double pct) {
+    if (!g_probe_ms) return 0;
+    return clock_sync_rtt_percentile(&g_clock, pct);
+}
+
+int drive_udp_set_redundancy(uint8_t k, const char *alt_ip, uint16_t alt_port) {
+    if (g_running) return -1; // 송신 중에는 변경 불가
+    if (k > DRIVE_RED_MAX_K) return -1;
+
+    // 두 경로로 보내면 수신측이 seq로 중복을 걸러야 하므로 기존 4바이트 포맷(seq 없음)은 쓰지 않음
+    if (alt_ip && k == 0) k = 1;
+
+    g_red_k = k;
+    g_hist_len = 0;
+    g_have_alt = 0;
+    if (alt_ip) {
+        memset(&g_alt_dest, 0, sizeof(g_alt_dest));
+        g_alt_dest.sin_family = AF_INET;
+        g_alt_dest.sin_port   = htons(alt_port);
+        if (inet_pton(AF_INET, alt_ip, &g_alt_dest.sin_addr) != 1) return -1;
+        g_have_alt = 1;
+    }
+    return 0;
+}
+
+int drive_udp_set_loss(double loss_pct, double mean_burst, unsigned seed) {
+    if (g_running) return -1;
+    if (loss_pct <= 0.0) { g_loss_on = 0; return 0; }
+    if (loss_pct >= 100.0 || mean_burst < 1.0) return -1;
+
+    // 평균 유실률 p, 평균 버스트 길이 b 가 되도록 전이 확률 결정
+    // leave = 1/b, enter = p * leave / (1 - p)
+    double p = loss_pct / 100.0;
+    double leave = 1.0 / mean_burst;
+    double enter = p * leave / (1.0 - p);
+    for (int i = 0; i < 2; i++) {
+        g_loss[i] = (Loss_Sim){ enter, leave, 0, seed + (unsigned)i * 7919u, 0 };
+    }
+    g_loss_on = 1;
+    return 0;
+}
+
+void drive_udp_get_tx_stats(uint32_t *sent, uint32_t *dropped) {
+    if (sent) *sent = g_sent;
+    if (dropped) *dropped = g_loss[0].dropped + g_loss[1].dropped;
+}
+
 void drive_udp_stop(void) {
     if (!g_running) return;
 
     g_running = 0;
     pthread_join(g_thread, NULL);
+    if (g_probe_ms) pthread_join(g_probe_thread, NULL);
 
     if (g_sock >= 0) {
         close(g_sock);
@@ -140,30 +345,102 @@ Drive_Payload drive_get_state(void) {
 }
 
 
+// 데모 main (다른 프로그램에 모듈로 링크할 때는 -DNO_DEMO_MAIN 으로 빌드)
+#ifndef NO_DEMO_MAIN
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
-int main(void) {
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-d dest_ip] [-p port] [-T period_ms] [-k history]\n"
+            "          [-a alt_ip] [-P alt_port] [-l loss_pct] [-b mean_burst] [-t seconds]\n"
+            "          [-r probe_ms]\n"
+            "  -k N   중복 전송: 패킷마다 최근 N개 상태를 실음 (0=기존 포맷, 최대 %d)\n"
+            "  -a IP  같은 패킷을 보조 목적지로도 전송 (-k 0이면 1로 올림)\n"
+            "  -l/-b  유실 주입 (평균 유실률 %%, 평균 버스트 길이)\n"
+            "  -t S   S초 동안 데모 시나리오 반복 (기본: 1회)\n"
+            "  -r MS  MS마다 시계 probe (offset/RTT 추정, 주행 패킷에 송신 시각 포함)\n",
+            prog, DRIVE_RED_MAX_K);
+}
+
+int main(int argc, char **argv) {
+    const char *dest_ip = "127.0.0.1";
+    uint16_t dest_port = 8080;
+    uint32_t period_ms = 20;
+    int k = 0;
+    const char *alt_ip = NULL;
+    uint16_t alt_port = 0;
+    double loss_pct = 0.0, mean_burst = 1.0;
+    int seconds = 0;
+    int probe_ms = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:p:T:k:a:P:l:b:t:r:h")) != -1) {
+        switch (opt) {
+            case 'd': dest_ip    = optarg; break;
+            case 'p': dest_port  = (uint16_t)atoi(optarg); break;
+            case 'T': period_ms  = (uint32_t)atoi(optarg); break;
+            case 'k': k          = atoi(optarg); break;
+            case 'a': alt_ip     = optarg; break;
+            case 'P': alt_port   = (uint16_t)atoi(optarg); break;
+            case 'l': loss_pct   = atof(optarg); break;
+            case 'b': mean_burst = atof(optarg); break;
+            case 't': seconds    = atoi(optarg); break;
+            case 'r': probe_ms   = atoi(optarg); break;
+            default:  usage(argv[0]); return 1;
+        }
+    }
+    if (alt_port == 0) alt_port = dest_port;
+
+    if (k < 0 || drive_udp_set_redundancy((uint8_t)k, alt_ip, alt_port) != 0) {
+        fprintf(stderr, "invalid redundancy options\n");
+        return 1;
+    }
+    if (drive_udp_set_loss(loss_pct, mean_burst, 1234u) != 0) {
+        fprintf(stderr, "invalid loss options\n");
+        return 1;
+    }
+    if (probe_ms < 0 || drive_udp_set_probe((uint32_t)probe_ms) != 0) {
+        fprintf(stderr, "invalid probe interval\n");
+        return 1;
+    }
+
     // 프로그램 시작과 동시에 송신 시작 (예: 20ms 주기)
-    if (drive_udp_start("127.0.0.1", 8080, 20) != 0) {
+    if (drive_udp_start(dest_ip, dest_port, period_ms) != 0) {
         perror("drive_udp_start");
         return 1;
     }
 
-    // 외부에서 상태 변경한다고 가정
-    drive_set_state(0, 0, 0);     // 정지
-    sleep(1);
+    time_t end = time(NULL) + seconds;
+    do {
+        // 외부에서 상태 변경한다고 가정
+        drive_set_state(0, 0, 0);     // 정지
+        sleep(1);
 
-    drive_set_state(10, 0, 80);   // 전진, 속도 80
-    sleep(2);
+        drive_set_state(10, 0, 80);   // 전진, 속도 80
+        sleep(2);
 
-    drive_set_steering(-30);      // 좌회전
-    sleep(2);
+        drive_set_steering(-30);      // 좌회전
+        sleep(2);
 
-    drive_set_state(0, 1, 60);    // 후진
-    sleep(2);
+        drive_set_state(0, 1, 60);    // 후진
+        sleep(2);
+    } while (time(NULL) < end);
+
+    int64_t  off;
+    uint64_t rtt;
+    if (drive_udp_get_clock(&off, &rtt)) {
+        printf("clock offset=%lld us rtt=%.1f us | rtt p50=%.1f p99=%.1f us\n",
+               (long long)(off / 1000), rtt / 1e3,
+               drive_udp_rtt_percentile(50.0) / 1e3, drive_udp_rtt_percentile(99.0) / 1e3);
+    }
 
     drive_udp_stop();
+
+    uint32_t sent, dropped;
+    drive_udp_get_tx_stats(&sent, &dropped);
+    printf("sent=%u injected_drop=%u\n", sent, dropped);
     return 0;
 }
-
+#endif
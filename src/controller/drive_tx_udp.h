@@ -3,6 +3,27 @@
 
 #include "ctrl_protocol.h"
 
+// 송신 루프 시작/종료
+int  drive_udp_start(const char *dest_ip, uint16_t dest_port, uint32_t period_ms);
+void drive_udp_stop(void);
+
+// (선택) 중복 전송: 패킷마다 최근 k개 상태를 실음 (k=0이면 기존 4바이트 포맷)
+// alt_ip가 있으면 같은 패킷을 보조 목적지로도 보냄 (이때 k=0은 1로 올림: 수신측 중복 제거에 seq 필요)
+// drive_udp_start() 전에 호출
+int  drive_udp_set_redundancy(uint8_t k, const char *alt_ip, uint16_t alt_port);
+
+// (테스트용) 송신측 유실 주입: 평균 유실률(%), 평균 버스트 길이(패킷). drive_udp_start() 전에 호출
+int  drive_udp_set_loss(double loss_pct, double mean_burst, unsigned seed);
+void drive_udp_get_tx_stats(uint32_t *sent, uint32_t *dropped);
+
+// (선택) 시계 probe: interval_ms마다 같은 UDP 채널로 PING을 보내 차량과의 시계 차이/RTT 추정
+// 0이면 끔. drive_udp_start() 전에 호출
+int  drive_udp_set_probe(uint32_t interval_ms);
+// 추정값 조회 (offset = 차량 시계 - 컨트롤러 시계, CLOCK_MONOTONIC ns). 아직 없으면 0
+int  drive_udp_get_clock(int64_t *offset_ns, uint64_t *rtt_ns);
+// RTT 분위수 (ns)
+uint64_t drive_udp_rtt_percentile(double pct);
+
 // 상태값 전체/부분 업데이트(외부에서 호출)
 void drive_set_state(int16_t steering_deg, uint8_t gear, uint8_t speed);
 void drive_set_steering(int16_t steering_deg);
@@ -0,0 +1,232 @@
+// fleet_load_tx.c
+// 여러 차량(수신 포트)에 주행 패킷을 동시에 보내는 부하 발생기
+// 목적지 i = <dest_ip>:<base_port + i>, 차량마다 위상이 다른 조향/속도 패턴을 주기 송신
+//
+// -s <ifname_prefix> 를 주면 폐루프: <prefix>i 에서 차량 상태 프레임(CAN_ID_STATUS)을 읽어
+// 마지막으로 보낸 속도 명령과 실제 속도의 차이(추종 오차), 상태가 끊긴 차량 수를 보고.
+// 없으면 피드백 없이 보내기만 하는 개루프 부하 발생기.
+// (vehicle_sim.c 상단의 테스트 예시 참고)
+#define _DEFAULT_SOURCE
+#include "drive_protocol.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// CAN 관련 헤더 (SocketCAN)
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+
+#define STATUS_STALE_NS 500000000ull   // 이 시간 동안 상태 프레임이 없으면 끊긴 차량으로 봄
+
+// 차량별 피드백 (-s 사용 시)
+typedef struct {
+    int      fd;
+    float    cmd_v;        // 마지막으로 보낸 속도 명령 (m/s, 후진은 음수)
+    uint64_t last_rx_ns;   // 마지막 상태 프레임 수신 시각
+    uint32_t rx;           // 보고 구간 동안 받은 상태 프레임 수
+    double   err_sum;      // 보고 구간 동안 |실제 속도 - 명령| 합
+} Vehicle_Fb;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void timespec_add_ns(struct timespec *ts, long ns) {
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+// 상태 프레임만 받는 논블로킹 CAN 소켓
+static int open_status_socket(const char *ifname) {
+    int s = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+    if (s < 0) {
+        perror("socket(PF_CAN)");
+        return -1;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+        fprintf(stderr, "ioctl(SIOCGIFINDEX) %s: %s\n", ifname, strerror(errno));
+        close(s);
+        return -1;
+    }
+
+    struct can_filter filt = { CAN_ID_STATUS, CAN_SFF_MASK };
+    if (setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, &filt, sizeof(filt)) < 0) {
+        perror("setsockopt(CAN_RAW_FILTER)");
+        close(s);
+        return -1;
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind(AF_CAN)");
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+static void drain_status(Vehicle_Fb *fb, uint64_t now) {
+    struct can_frame f;
+    while (read(fb->fd, &f, sizeof(f)) == (ssize_t)sizeof(f)) {
+        if (f.can_dlc < DRIVE_STATUS_LEN) continue;
+        Drive_Status st = drive_status_decode(f.data);
+        fb->err_sum += fabsf(st.v_mps - fb->cmd_v);
+        fb->rx++;
+        fb->last_rx_ns = now;
+    }
+}
+
+static void print_feedback(Vehicle_Fb *fb, int count, uint64_t now) {
+    uint64_t rx = 0;
+    double err_sum = 0.0, worst = -1.0;
+    int worst_i = -1, stale = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (fb[i].last_rx_ns == 0 || now - fb[i].last_rx_ns > STATUS_STALE_NS) stale++;
+        if (fb[i].rx) {
+            double e = fb[i].err_sum / fb[i].rx;
+            if (e > worst) { worst = e; worst_i = i; }
+        }
+        rx += fb[i].rx;
+        err_sum += fb[i].err_sum;
+        fb[i].rx = 0;
+        fb[i].err_sum = 0.0;
+    }
+
+    printf("[FB] status_rx=%llu stale=%d/%d | |v err| mean=%.3f m/s",
+           (unsigned long long)rx, stale, count, rx ? err_sum / (double)rx : 0.0);
+    if (worst_i >= 0) printf(" worst=%.3f m/s (vehicle %d)", worst, worst_i);
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    const char *status_prefix = NULL;
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        if (opt == 's') status_prefix = optarg;
+        else            bad = 1;
+    }
+    int nargs = argc - optind;
+    if (bad || nargs < 3 || nargs > 5) {
+        fprintf(stderr, "Usage: %s [-s status_ifname_prefix] <dest_ip> <base_port> <count> [period_ms] [seconds]\n",
+                argv[0]);
+        return 1;
+    }
+    char **args = argv + optind;
+
+    const char *dest_ip  = args[0];
+    int base_port        = atoi(args[1]);
+    int count            = atoi(args[2]);
+    int period_ms        = (nargs > 3) ? atoi(args[3]) : 20;
+    int seconds          = (nargs > 4) ? atoi(args[4]) : 0;   // 0이면 무한
+    if (count <= 0 || base_port <= 0 || base_port + count > 65536 || period_ms <= 0) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    struct sockaddr_in *dests = calloc((size_t)count, sizeof(*dests));
+    Vehicle_Fb *fb = calloc((size_t)count, sizeof(*fb));
+    if (!dests || !fb) return 1;
+    for (int i = 0; i < count; i++) {
+        dests[i].sin_family = AF_INET;
+        dests[i].sin_port   = htons((uint16_t)(base_port + i));
+        if (inet_pton(AF_INET, dest_ip, &dests[i].sin_addr) != 1) {
+            fprintf(stderr, "bad dest_ip\n");
+            return 1;
+        }
+
+        fb[i].fd = -1;
+        if (status_prefix) {
+            char ifname[IFNAMSIZ];
+            snprintf(ifname, sizeof(ifname), "%s%d", status_prefix, i);
+            fb[i].fd = open_status_socket(ifname);
+            if (fb[i].fd < 0) return 1;
+        }
+    }
+
+    printf("Sending to %s:%d..%d every %d ms (%s)\n", dest_ip, base_port, base_port + count - 1, period_ms,
+           status_prefix ? "closed loop: reading CAN status" : "open loop: no feedback");
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t ticks = 0, sent = 0, errors = 0;
+    uint64_t total_ticks = seconds > 0 ? (uint64_t)seconds * 1000u / (uint64_t)period_ms : 0;
+
+    while (total_ticks == 0 || ticks < total_ticks) {
+        double t = (double)ticks * period_ms / 1000.0;
+        uint64_t now = now_ns();
+
+        for (int i = 0; i < count; i++) {
+            // 지난 주기 동안 들어온 상태는 직전 명령과 비교
+            if (fb[i].fd >= 0) drain_status(&fb[i], now);
+
+            // 차량마다 위상을 다르게: 8초 주기로 조향 +-30도, 속도 0~200, 가끔 후진
+            double ph = t * 2.0 * M_PI / 8.0 + (double)i * 0.37;
+            Drive_Payload s;
+            s.steering_deg = (int16_t)lrint(30.0 * sin(ph));
+            s.speed        = (uint8_t)lrint(100.0 + 100.0 * sin(ph * 0.5));
+            s.gear         = (cos(ph * 0.25) < -0.9) ? 1 : 0;
+
+            float v = (float)s.speed / 255.0f * DRIVE_SPEED_FULL_MPS;
+            fb[i].cmd_v = s.gear == 1 ? -v : v;
+
+            uint8_t pkt[DRIVE_STATE_LEN];
+            drive_state_encode(pkt, &s);
+            if (sendto(sock, pkt, sizeof(pkt), 0,
+                       (struct sockaddr *)&dests[i], sizeof(dests[i])) == (ssize_t)sizeof(pkt)) {
+                sent++;
+            } else {
+                errors++;
+            }
+        }
+
+        ticks++;
+        if (ticks % (5000u / (unsigned)period_ms + 1) == 0) {
+            printf("[TX] ticks=%llu sent=%llu errors=%llu\n",
+                   (unsigned long long)ticks, (unsigned long long)sent, (unsigned long long)errors);
+            if (status_prefix) print_feedback(fb, count, now);
+            fflush(stdout);
+        }
+
+        timespec_add_ns(&next, (long)period_ms * 1000000L);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+    }
+
+    printf("[TX] done sent=%llu errors=%llu\n", (unsigned long long)sent, (unsigned long long)errors);
+    if (status_prefix) print_feedback(fb, count, now_ns());
+    for (int i = 0; i < count; i++) {
+        if (fb[i].fd >= 0) close(fb[i].fd);
+    }
+    free(fb);
+    free(dests);
+    close(sock);
+    return 0;
+}
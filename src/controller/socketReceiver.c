@@ -1,15 +1,28 @@
-#define _POSIX_C_SOURCE 200809L
-#include "ctrl_protocol.h"
+#define _DEFAULT_SOURCE
+#include "drive_protocol.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 
+// CAN 관련 헤더 (SocketCAN)
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+
+// 비상정지 CAN 전송 재시도 간격
+#define CAN_RETRY_POLL_MS 10
+#define CAN_RETRY_MIN_US  500
+#define CAN_RETRY_MAX_US  20000
+
 static void hexdump(const void *buf, size_t len) {
     const unsigned char *p = (const unsigned char*)buf;
     for (size_t i = 0; i < len; i++) {
@@ -33,11 +46,89 @@ static int recv_all(int fd, void *buf, size_t len) {
     return 1; // success
 }
 
+// SocketCAN용 CAN 소켓 열기
+static int open_can_socket(const char *ifname) {
+    int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (s < 0) {
+        perror("socket(PF_CAN)");
+        return -1;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name) - 1);
+
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+        perror("ioctl(SIOCGIFINDEX)");
+        close(s);
+        return -1;
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind(AF_CAN)");
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+// 명령 우선순위에 맞는 CAN ID로 전달 (ID가 작을수록 버스 중재에서 이김)
+// data: cmd(1) + payload (주행만 drive_protocol.h의 4바이트 상태)
+static void forward_to_can(int canfd, const Ctrl_Message *m) {
+    struct can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id  = ctrl_priority_can_id(ctrl_cmd_priority(m->cmd));
+
+    if (m->cmd == CMD_DRIVE) {
+        // 0x123은 UDP 경로(driveRecvAndCanTx)와 같은 4바이트 steer/gear/speed 레이아웃이어야 함
+        frame.can_dlc = DRIVE_STATE_LEN;
+        drive_state_encode(frame.data, &m->payload.drive_payload);
+    } else {
+        frame.can_dlc = sizeof(Ctrl_Message);
+        memcpy(frame.data, m, sizeof(Ctrl_Message));
+    }
+
+    if (write(canfd, &frame, sizeof(frame)) == (ssize_t)sizeof(frame)) return;
+    perror("write(can)");
+    if (ctrl_cmd_priority(m->cmd) != CTRL_PRIO_ESTOP) return;
+
+    // 비상정지/해제는 버리지 않음: 송신 큐가 빌 때까지 기다렸다가 성공할 때까지 재시도
+    // (ENOBUFS면 CAN raw 소켓의 POLLOUT이 바로 깨어날 수 있어서 짧은 backoff도 같이 둠)
+    long backoff_us = CAN_RETRY_MIN_US;
+    uint32_t tries = 0;
+    while (1) {
+        struct pollfd pfd = { canfd, POLLOUT, 0 };
+        poll(&pfd, 1, CAN_RETRY_POLL_MS);
+        struct timespec ts = { 0, backoff_us * 1000L };
+        nanosleep(&ts, NULL);
+        if (backoff_us < CAN_RETRY_MAX_US) backoff_us *= 2;
+
+        tries++;
+        if (write(canfd, &frame, sizeof(frame)) == (ssize_t)sizeof(frame)) break;
+        if (tries % 100 == 0) fprintf(stderr, "write(can) cmd=0x%02X still failing: %s\n", m->cmd, strerror(errno));
+    }
+    printf("[CAN] cmd 0x%02X sent after %u retries\n", m->cmd, tries);
+}
+
 static void print_message(const Ctrl_Message *m) {
     printf("=== Ctrl_Message ===\n");
     printf("cmd: 0x%02X\n", m->cmd);
 
     switch (m->cmd) {
+        case CMD_ESTOP:
+            printf("payload: ESTOP\n");
+            break;
+
+        case CMD_ESTOP_CLEAR:
+            printf("payload: ESTOP_CLEAR\n");
+            break;
+
         case CMD_TRACK_START:
             printf("payload: TRACK_START\n");
             break;
@@ -75,13 +166,25 @@ static void print_message(const Ctrl_Message *m) {
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <port>\n", argv[0]);
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s <port> [can_ifname]\n", argv[0]);
         return 1;
     }
 
     int port = atoi(argv[1]);
 
+    // (선택) 받은 명령을 CAN으로 전달
+    int canfd = -1;
+    if (argc == 3) {
+        canfd = open_can_socket(argv[2]);
+        if (canfd < 0) {
+            fprintf(stderr, "Failed to open CAN interface %s\n", argv[2]);
+            return 1;
+        }
+        printf("Forwarding commands to %s (ESTOP=0x%03X TRACK=0x%03X COSMETIC=0x%03X)\n",
+               argv[2], CAN_ID_ESTOP, CAN_ID_TRACK, CAN_ID_COSMETIC);
+    }
+
     int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (listen_fd < 0) { perror("socket"); return 1; }
 
@@ -127,6 +230,8 @@ int main(int argc, char **argv) {
             Ctrl_Message m;
             int r = recv_all(cfd, &m, sizeof(m));
             if (r == 1) {
+                // 비상정지는 로그 출력보다 먼저 CAN으로
+                if (canfd >= 0) forward_to_can(canfd, &m);
                 print_message(&m);
             } else if (r == 0) {
                 printf("Client disconnected.\n");
@@ -140,6 +245,7 @@ int main(int argc, char **argv) {
         close(cfd);
     }
 
+    if (canfd >= 0) close(canfd);
     close(listen_fd);
     return 0;
 }
@@ -1,4 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
+#include "clock_sync.h"
+#include "drive_protocol.h"
+
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
@@ -6,12 +9,58 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 
-static int16_t parse_i16_be(const uint8_t b[2]) {
-    uint16_t u = ((uint16_t)b[0] << 8) | (uint16_t)b[1];
-    return (int16_t)ntohs(u); // htons/ntohs는 uint16_t지만 2's complement 그대로 유지됨
+// ---- 갱신 간격 통계 ----
+// 새 상태가 반영되는 간격(ms)을 1ms 단위 히스토그램으로 모음.
+// 유실이 있으면 꼬리(p99/max)가 송신 주기의 배수로 늘어남 -> 중복 전송 효과 확인용
+#define GAP_BUCKETS 1000
+
+static uint32_t g_gap_hist[GAP_BUCKETS + 1];   // 마지막 칸은 1초 이상
+static uint32_t g_gap_count = 0;
+static uint32_t g_gap_max = 0;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void gap_record(uint32_t ms) {
+    g_gap_hist[ms < GAP_BUCKETS ? ms : GAP_BUCKETS]++;
+    g_gap_count++;
+    if (ms > g_gap_max) g_gap_max = ms;
+}
+
+static uint32_t gap_percentile(double pct) {
+    uint32_t target = (uint32_t)(g_gap_count * pct / 100.0);
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i <= GAP_BUCKETS; i++) {
+        acc += g_gap_hist[i];
+        if (acc > target) return i;
+    }
+    return GAP_BUCKETS;
+}
+
+// 컨트롤러가 probe로 알려준 시계 offset/RTT, 단방향 지연(명령 나이) 히스토그램
+static Clock_Sync g_clock;
+static Lat_Hist g_age_hist;
+
+static void print_stats(const Drive_Dedup *d) {
+    printf("[STATS] accepted=%u dup=%u recovered=%u lost=%u resets=%u | gap ms p50=%u p99=%u max=%u\n",
+           d->accepted, d->duplicate, d->recovered, d->lost, d->resets,
+           gap_percentile(50.0), gap_percentile(99.0), g_gap_max);
+
+    int64_t  off;
+    uint64_t rtt;
+    if (clock_sync_get(&g_clock, &off, &rtt)) {
+        printf("[CLOCK] offset(ctrl-car)=%lld us rtt=%.1f us (p99 %.1f us) | one-way p50=%.1f p99=%.1f us\n",
+               (long long)(off / 1000), rtt / 1e3, clock_sync_rtt_percentile(&g_clock, 99.0) / 1e3,
+               lat_hist_percentile(&g_age_hist, 50.0) / 1e3,
+               lat_hist_percentile(&g_age_hist, 99.0) / 1e3);
+    }
 }
 
 int main(int argc, char **argv) {
@@ -43,39 +92,74 @@ int main(int argc, char **argv) {
     printf("UDP receiver listening on 0.0.0.0:%d\n", port);
     printf("Expecting 4 bytes: steering(int16 BE) + gear(uint8) + speed(uint8)\n");
 
+    printf("             or redundant: magic + seq + count + epoch + count * 4 bytes\n");
+
+    Drive_Dedup dedup;
+    memset(&dedup, 0, sizeof(dedup));
+    clock_sync_init(&g_clock);
+    uint64_t last_update = 0;
+    uint64_t last_stats = now_ms();
+
     while (1) {
-        uint8_t buf[4];
+        uint8_t buf[DRIVE_PKT_MAX_LEN + DRIVE_PROBE_PING_LEN];
         struct sockaddr_in src;
         socklen_t slen = sizeof(src);
 
         ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&src, &slen);
+        uint64_t rx_ns = clock_sync_now_ns();
         if (n < 0) {
             if (errno == EINTR) continue;
             perror("recvfrom");
             break;
         }
-        if (n != 4) {
+
+        Drive_Probe pr;
+        if (drive_probe_parse(buf, (long)n, &pr) == 0) {
+            clock_sync_answer_ping(&g_clock, fd, &pr, rx_ns, &src);
+            continue;
+        }
+
+        Drive_Packet pkt;
+        if (drive_packet_parse(buf, (long)n, &pkt) != 0) {
             char ipbuf[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &src.sin_addr, ipbuf, sizeof(ipbuf));
-            printf("[WARN] got %zd bytes from %s:%u (expected 4)\n",
+            printf("[WARN] got %zd bytes from %s:%u (bad drive packet)\n",
                    n, ipbuf, ntohs(src.sin_port));
             continue;
         }
 
-        int16_t steering = parse_i16_be(&buf[0]);
-        uint8_t gear  = buf[2];
-        uint8_t speed = buf[3];
+        int fresh = drive_dedup_accept(&dedup, &pkt);
+        if (fresh == 0) continue;   // 다른 경로로 이미 받은 패킷
+
+        uint64_t t = now_ms();
+        if (last_update) gap_record((uint32_t)(t - last_update));
+        last_update = t;
+
+        if (pkt.has_tx_ns && clock_sync_get(&g_clock, NULL, NULL)) {
+            uint64_t tx_local = clock_sync_to_local(&g_clock, pkt.tx_ns);
+            if (rx_ns > tx_local) lat_hist_add(&g_age_hist, rx_ns - tx_local);
+        }
 
         char ipbuf[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &src.sin_addr, ipbuf, sizeof(ipbuf));
 
-        printf("from %s:%u | steering=%d deg | gear=%u | speed=%u\n",
-               ipbuf, ntohs(src.sin_port), steering, gear, speed);
+        // 복구된 이전 상태부터 순서대로 (마지막이 최신)
+        for (int i = fresh - 1; i >= 0; i--) {
+            const Drive_Payload *st = &pkt.states[i];
+            printf("from %s:%u | seq=%u%s | steering=%d deg | gear=%u | speed=%u\n",
+                   ipbuf, ntohs(src.sin_port), (unsigned)(uint16_t)(pkt.seq - i),
+                   i ? " (recovered)" : "", st->steering_deg, st->gear, st->speed);
+        }
 
-        // 여기서 실제 RC카 제어 함수 호출하면 됨:
+        // 여기서 실제 RC카 제어 함수 호출하면 됨 (최신 상태 pkt.states[0]):
         // rc_set_steering(steering);
         // rc_set_gear(gear);
         // rc_set_speed(speed);
+
+        if (t - last_stats >= 5000) {
+            print_stats(&dedup);
+            last_stats = t;
+        }
     }
 
     close(fd);
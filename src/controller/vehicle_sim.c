@@ -0,0 +1,346 @@
+// vehicle_sim.c
+// 실차 없이 컨트롤러 -> CAN 전체 경로를 돌려보기 위한 차량 ECU 시뮬레이터
+//
+// - 차량 하나당 vcan 인터페이스 하나 (<prefix>0, <prefix>1, ...)
+// - 주행 프레임(CAN_ID_DRIVE)을 받아 간단한 운동학 모델(자전거 모델)로 적분
+// - 비상정지(CAN_ID_ESTOP)를 받으면 즉시 정지, 해제(CMD_ESTOP_CLEAR)될 때까지 주행 프레임 무시
+// - 상태 프레임(CAN_ID_STATUS)을 주기적으로 다시 송신
+//
+// 수백 대를 한 스레드로 돌리기 위해 차량 상태를 배열 단위(SoA)로 두고
+// epoll로 CAN 수신, timerfd로 고정 주기 갱신.
+//
+// 준비 (예: 100대):
+//   sudo modprobe vcan
+//   for i in $(seq 0 99); do sudo ip link add vcan$i type vcan; sudo ip link set up vcan$i; done
+// 폐루프 부하 테스트 (fleet_load_tx가 상태 프레임을 읽어 명령 대비 추종 오차를 보고):
+//   ./vehicle_sim vcan 100
+//   for i in $(seq 0 99); do ./driveRecvAndCanTx -i vcan$i $((9000+i)) > /dev/null & done
+//   ./fleet_load_tx -s vcan 127.0.0.1 9000 100 20
+#define _DEFAULT_SOURCE
+#include "drive_protocol.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// CAN 관련 헤더 (SocketCAN)
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+
+#define SIM_MAX_VEHICLES 1024
+#define SIM_WHEELBASE_M  0.26f   // 휠베이스 (m)
+#define SIM_MAX_STEER    35.0f   // 실제 바퀴 최대 조향각 (deg)
+#define SIM_SPEED_TAU    0.3f    // 모터 응답 시정수 (s)
+#define SIM_CMD_TIMEOUT  0.5f    // 이 시간 동안 주행 프레임이 없으면 감속 정지 (s)
+#define DEG2RAD          0.017453292f
+
+// 차량 상태 (SoA: 갱신 루프가 필드별로 연속 메모리를 훑도록)
+typedef struct {
+    uint32_t n;
+
+    int      fd[SIM_MAX_VEHICLES];
+
+    // 명령 (CAN 수신 시 갱신)
+    float    cmd_steer[SIM_MAX_VEHICLES];   // deg
+    float    cmd_speed[SIM_MAX_VEHICLES];   // m/s, 후진은 음수
+    float    cmd_age[SIM_MAX_VEHICLES];     // 마지막 주행 프레임 이후 경과 (s)
+    uint8_t  estop[SIM_MAX_VEHICLES];       // 비상정지 유지 중
+
+    // 운동학 상태
+    float    x[SIM_MAX_VEHICLES];           // m
+    float    y[SIM_MAX_VEHICLES];           // m
+    float    heading[SIM_MAX_VEHICLES];     // rad
+    float    v[SIM_MAX_VEHICLES];           // m/s
+
+    // 통계
+    uint32_t rx_drive[SIM_MAX_VEHICLES];
+    uint32_t rx_estop[SIM_MAX_VEHICLES];
+    uint32_t ignored[SIM_MAX_VEHICLES];     // 비상정지 중 무시한 주행 프레임
+} Fleet;
+
+static Fleet g_fleet;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// SocketCAN용 CAN 소켓 열기 (논블로킹, 필요한 ID만 받도록 필터)
+static int open_can_socket(const char *ifname) {
+    int s = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+    if (s < 0) {
+        perror("socket(PF_CAN)");
+        return -1;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+        fprintf(stderr, "ioctl(SIOCGIFINDEX) %s: %s\n", ifname, strerror(errno));
+        close(s);
+        return -1;
+    }
+
+    struct can_filter filt[2] = {
+        { CAN_ID_DRIVE, CAN_SFF_MASK },
+        { CAN_ID_ESTOP, CAN_SFF_MASK },
+    };
+    if (setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, filt, sizeof(filt)) < 0) {
+        perror("setsockopt(CAN_RAW_FILTER)");
+        close(s);
+        return -1;
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind(AF_CAN)");
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+static void on_frame(uint32_t i, const struct can_frame *f) {
+    Fleet *fl = &g_fleet;
+
+    switch (f->can_id & CAN_SFF_MASK) {
+        case CAN_ID_DRIVE: {
+            if (f->can_dlc < DRIVE_STATE_LEN) return;
+            if (fl->estop[i]) {
+                fl->ignored[i]++;
+                return;
+            }
+            Drive_Payload d = drive_state_decode(f->data);
+            float speed = (float)d.speed / 255.0f * DRIVE_SPEED_FULL_MPS;
+            fl->cmd_speed[i] = (d.gear == 1) ? -speed : speed;
+            fl->cmd_steer[i] = (float)d.steering_deg;
+            fl->cmd_age[i]   = 0.0f;
+            fl->rx_drive[i]++;
+            break;
+        }
+        case CAN_ID_ESTOP:
+            // data[0]은 명령 코드 (socketReceiver가 Ctrl_Message 그대로 전달), 해제가 아니면 정지
+            if (f->can_dlc >= 1 && f->data[0] == CMD_ESTOP_CLEAR) {
+                fl->estop[i] = 0;
+                break;
+            }
+            fl->estop[i]     = 1;
+            fl->cmd_speed[i] = 0.0f;
+            fl->v[i]         = 0.0f;
+            fl->rx_estop[i]++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void drain_socket(uint32_t i) {
+    struct can_frame f;
+    while (read(g_fleet.fd[i], &f, sizeof(f)) == (ssize_t)sizeof(f)) {
+        on_frame(i, &f);
+    }
+}
+
+// 전체 차량 한 스텝 적분
+static void fleet_step(float dt) {
+    Fleet *fl = &g_fleet;
+    const uint32_t n = fl->n;
+    const float alpha = dt / (SIM_SPEED_TAU + dt);
+
+    // 명령 타임아웃: 끊기면 목표 속도 0
+    for (uint32_t i = 0; i < n; i++) {
+        fl->cmd_age[i] += dt;
+        if (fl->cmd_age[i] > SIM_CMD_TIMEOUT) fl->cmd_speed[i] = 0.0f;
+    }
+    // 모터: 1차 지연
+    for (uint32_t i = 0; i < n; i++) {
+        fl->v[i] += alpha * (fl->cmd_speed[i] - fl->v[i]);
+    }
+    // 자전거 모델: yaw rate = v / L * tan(delta)
+    for (uint32_t i = 0; i < n; i++) {
+        float delta = fl->cmd_steer[i];
+        if (delta >  SIM_MAX_STEER) delta =  SIM_MAX_STEER;
+        if (delta < -SIM_MAX_STEER) delta = -SIM_MAX_STEER;
+        fl->heading[i] += fl->v[i] / SIM_WHEELBASE_M * tanf(delta * DEG2RAD) * dt;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        fl->x[i] += fl->v[i] * cosf(fl->heading[i]) * dt;
+        fl->y[i] += fl->v[i] * sinf(fl->heading[i]) * dt;
+    }
+}
+
+// 상태 프레임 (drive_protocol.h 참고)
+static uint32_t fleet_publish(void) {
+    Fleet *fl = &g_fleet;
+    uint32_t sent = 0;
+
+    struct can_frame f;
+    memset(&f, 0, sizeof(f));
+    f.can_id  = CAN_ID_STATUS;
+    f.can_dlc = DRIVE_STATUS_LEN;
+
+    for (uint32_t i = 0; i < fl->n; i++) {
+        Drive_Status st;
+        st.v_mps       = fl->v[i];
+        st.heading_deg = remainderf(fl->heading[i], 2.0f * (float)M_PI) / DEG2RAD;
+        st.x_m         = fl->x[i];
+        st.y_m         = fl->y[i];
+        drive_status_encode(f.data, &st);
+        if (write(fl->fd[i], &f, sizeof(f)) == (ssize_t)sizeof(f)) sent++;
+    }
+    return sent;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 5) {
+        fprintf(stderr, "Usage: %s <ifname_prefix> <count> [sim_hz] [status_hz]\n", argv[0]);
+        return 1;
+    }
+
+    const char *prefix = argv[1];
+    uint32_t count     = (uint32_t)atoi(argv[2]);
+    uint32_t sim_hz    = (argc > 3) ? (uint32_t)atoi(argv[3]) : 200;
+    uint32_t status_hz = (argc > 4) ? (uint32_t)atoi(argv[4]) : 20;
+    if (count == 0 || count > SIM_MAX_VEHICLES || sim_hz == 0 || sim_hz > 10000 ||
+        status_hz == 0 || status_hz > sim_hz) {
+        fprintf(stderr, "count must be 1..%d, sim_hz 1..10000, 0 < status_hz <= sim_hz\n", SIM_MAX_VEHICLES);
+        return 1;
+    }
+
+    int ep = epoll_create1(0);
+    if (ep < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        char ifname[IFNAMSIZ];
+        snprintf(ifname, sizeof(ifname), "%s%u", prefix, i);
+        int s = open_can_socket(ifname);
+        if (s < 0) return 1;
+
+        g_fleet.fd[i] = s;
+        g_fleet.cmd_age[i] = SIM_CMD_TIMEOUT;
+
+        struct epoll_event ev;
+        ev.events   = EPOLLIN;
+        ev.data.u32 = i;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, s, &ev) < 0) {
+            perror("epoll_ctl");
+            return 1;
+        }
+    }
+    g_fleet.n = count;
+
+    // 고정 주기 타이머
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (tfd < 0) {
+        perror("timerfd_create");
+        return 1;
+    }
+    // tv_nsec는 1e9 미만이어야 함 (sim_hz=1이면 1초 = tv_sec)
+    long period_ns = 1000000000L / (long)sim_hz;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec  = period_ns / 1000000000L;
+    its.it_interval.tv_nsec = period_ns % 1000000000L;
+    its.it_value = its.it_interval;
+    if (timerfd_settime(tfd, 0, &its, NULL) < 0) {
+        perror("timerfd_settime");
+        return 1;
+    }
+
+    struct epoll_event tev;
+    tev.events   = EPOLLIN;
+    tev.data.u32 = UINT32_MAX;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &tev) < 0) {
+        perror("epoll_ctl(timerfd)");
+        return 1;
+    }
+
+    printf("Simulating %u vehicles on %s0..%s%u | sim %u Hz | status 0x%03X at %u Hz\n",
+           count, prefix, prefix, count - 1, sim_hz, CAN_ID_STATUS, status_hz);
+
+    const float dt = 1.0f / (float)sim_hz;
+    const uint32_t publish_every = sim_hz / status_hz;
+    uint32_t tick = 0;
+    uint64_t step_ns_total = 0, step_ns_max = 0, steps = 0, status_sent = 0;
+    uint64_t last_report = now_ns();
+
+    struct epoll_event evs[64];
+    while (1) {
+        int n = epoll_wait(ep, evs, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int k = 0; k < n; k++) {
+            uint32_t id = evs[k].data.u32;
+            if (id != UINT32_MAX) {
+                drain_socket(id);
+                continue;
+            }
+
+            uint64_t expirations = 0;
+            if (read(tfd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) continue;
+
+            // 밀린 틱도 모두 적분 (시뮬레이션 시간이 실제 시간과 맞도록)
+            uint64_t t0 = now_ns();
+            for (uint64_t e = 0; e < expirations; e++) {
+                fleet_step(dt);
+                if (++tick % publish_every == 0) status_sent += fleet_publish();
+            }
+            uint64_t el = now_ns() - t0;
+            step_ns_total += el;
+            steps++;
+            if (el > step_ns_max) step_ns_max = el;
+        }
+
+        uint64_t t = now_ns();
+        if (t - last_report >= 5000000000ull) {
+            uint64_t rx = 0, estop = 0, ignored = 0;
+            uint32_t active = 0, stopped = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                rx += g_fleet.rx_drive[i];
+                estop += g_fleet.rx_estop[i];
+                ignored += g_fleet.ignored[i];
+                if (g_fleet.cmd_age[i] <= SIM_CMD_TIMEOUT) active++;
+                if (g_fleet.estop[i]) stopped++;
+            }
+            printf("[SIM] active=%u/%u estopped=%u drive_rx=%llu estop_rx=%llu ignored=%llu status_tx=%llu | "
+                   "tick avg=%.1f us max=%.1f us | veh0 x=%.2f y=%.2f v=%.2f\n",
+                   active, count, stopped, (unsigned long long)rx, (unsigned long long)estop,
+                   (unsigned long long)ignored, (unsigned long long)status_sent,
+                   steps ? step_ns_total / 1e3 / (double)steps : 0.0, step_ns_max / 1e3,
+                   g_fleet.x[0], g_fleet.y[0], g_fleet.v[0]);
+            fflush(stdout);
+            step_ns_total = step_ns_max = steps = 0;
+            last_report = t;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) close(g_fleet.fd[i]);
+    close(tfd);
+    close(ep);
+    return 0;
+}
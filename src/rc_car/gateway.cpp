@@ -1,14 +1,31 @@
 // udp_ctrl_receiver.cpp
 #include <arpa/inet.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <iostream>
-#include <stdexcept>
-#include <string>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+// 패킷 처리 경로는 힙 할당/예외 없이 동작해야 함 (잘못된 패킷이 몰려와도 비용이 일정하도록)
+// - 파싱 결과는 예외 대신 상태 코드로 반환
+// - 출력은 미리 잡아둔 버퍼에 snprintf로 쌓았다가 한 번에 write
 
 struct CtrlMessage {
     uint8_t  cmd{};
@@ -17,10 +34,24 @@ struct CtrlMessage {
     uint8_t  speed{};  // 0~255
 };
 
-static CtrlMessage parse_ctrl_packet(const uint8_t* buf, size_t len) {
-    if (len < 5) throw std::runtime_error("packet too short");
+enum class ParseStatus : uint8_t {
+    Ok,
+    TooShort,
+};
+
+static constexpr size_t kCtrlPacketLen = 5;
+
+static const char* parse_status_str(ParseStatus st) noexcept {
+    switch (st) {
+        case ParseStatus::Ok:       return "ok";
+        case ParseStatus::TooShort: return "too short";
+    }
+    return "unknown";
+}
+
+static ParseStatus parse_ctrl_packet(const uint8_t* buf, size_t len, CtrlMessage& m) noexcept {
+    if (len < kCtrlPacketLen) return ParseStatus::TooShort;
 
-    CtrlMessage m{};
     m.cmd = buf[0];
 
     uint16_t steer_be{};
@@ -30,16 +61,107 @@ static CtrlMessage parse_ctrl_packet(const uint8_t* buf, size_t len) {
 
     m.gear  = buf[3];
     m.speed = buf[4];
-    return m;
+    return ParseStatus::Ok;
 }
 
-int main(int argc, char** argv) {
-    const uint16_t port = (argc >= 2) ? static_cast<uint16_t>(std::stoi(argv[1])) : 9000;
+// 알려진 기어는 정적 문자열, 나머지는 호출자가 준 버퍼에 "UNKNOWN(n)"
+static const char* gear_str(uint8_t gear, char* scratch, size_t cap) noexcept {
+    if (gear == 0) return "FWD";
+    if (gear == 1) return "BWD";
+    std::snprintf(scratch, cap, "UNKNOWN(%u)", static_cast<unsigned>(gear));
+    return scratch;
+}
+
+// 고정 크기 출력 버퍼 (fd 하나당 하나)
+class OutBuf {
+public:
+    explicit OutBuf(int fd) noexcept : fd_(fd) {}
+
+    template <typename... Args>
+    void printf(const char* fmt, Args... args) noexcept {
+        if (cap_ - len_ < kMaxLine) flush();
+        int w = std::snprintf(data_ + len_, cap_ - len_, fmt, args...);
+        if (w > 0) len_ += (static_cast<size_t>(w) < cap_ - len_) ? static_cast<size_t>(w) : cap_ - len_ - 1;
+    }
+
+    bool pending() const noexcept { return len_ != 0; }
+
+    void flush() noexcept {
+        size_t off = 0;
+        while (off < len_) {
+            ssize_t n = ::write(fd_, data_ + off, len_ - off);
+            if (n > 0) { off += static_cast<size_t>(n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            break; // 출력 실패 시 버림 (수신 루프는 계속)
+        }
+        len_ = 0;
+    }
+
+private:
+    static constexpr size_t kMaxLine = 256;
+    static constexpr size_t cap_ = 64 * 1024;
+    int    fd_;
+    size_t len_ = 0;
+    char   data_[cap_];
+};
+
+// 패킷 하나 처리: 파싱 + 로그 한 줄
+static ParseStatus handle_packet(const uint8_t* buf, size_t len,
+                                 const char* src_ip, uint16_t src_port,
+                                 OutBuf& out, OutBuf& err) noexcept {
+    CtrlMessage msg{};
+    ParseStatus st = parse_ctrl_packet(buf, len, msg);
+    if (st != ParseStatus::Ok) {
+        err.printf("drop: %s (%zuB) from %s:%u\n",
+                   parse_status_str(st), len, src_ip, static_cast<unsigned>(src_port));
+        return st;
+    }
+
+    char gear_buf[16];
+    out.printf("from %s:%u | cmd=0x%x steering=%d gear=%s speed=%d\n",
+               src_ip, static_cast<unsigned>(src_port),
+               static_cast<unsigned>(msg.cmd), static_cast<int>(msg.steering_deg),
+               gear_str(msg.gear, gear_buf, sizeof(gear_buf)),
+               static_cast<int>(msg.speed));
+    return st;
+}
+
+// ---- 샤딩 수신 모드 ----
+// 워커 N개가 각자 SO_REUSEPORT 소켓을 갖고 코어에 고정되어 수신 (샤드 간 공유 상태/락 없음).
+// 커널이 기본으로 4-tuple 해시로 흐름을 나눠주고, --steer src 이면 출발지 IP 기준으로 나눔
+// (차량 하나의 흐름이 항상 같은 샤드로 가도록).
+
+enum class Steer : uint8_t { Hash, SrcIp };
+
+// 샤드 통계: 소유 스레드만 쓰고 통계 출력 스레드는 읽기만 함
+struct ShardStats {
+    std::atomic<uint64_t> rx{0};
+    std::atomic<uint64_t> valid{0};
+    std::atomic<uint64_t> malformed{0};
+};
+
+struct alignas(64) Shard {
+    int         fd  = -1;
+    int         cpu = -1;
+    bool        quiet = false;
+    ShardStats  stats;
+    std::thread thread;
+};
 
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) { g_stop.store(true); }
+
+static int open_shard_socket(uint16_t port, bool reuseport) {
     int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
-    if (fd < 0) {
-        perror("socket");
-        return 1;
+    if (fd < 0) return -1;
+
+    if (reuseport) {
+        int one = 1;
+        if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+            ::close(fd);
+            return -1;
+        }
     }
 
     sockaddr_in bind_addr{};
@@ -48,56 +170,369 @@ int main(int argc, char** argv) {
     bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
 
     if (::bind(fd, reinterpret_cast<sockaddr*>(&bind_addr), sizeof(bind_addr)) < 0) {
-        perror("bind");
         ::close(fd);
-        return 1;
+        return -1;
     }
+    return fd;
+}
 
-    std::cout << "UDP listening on 0.0.0.0:" << port << "\n";
+// reuseport 그룹에 cBPF를 붙여서 "출발지 IPv4 % N" 번째 소켓으로 보냄
+static int attach_src_steering(int fd, unsigned shards) {
+    sock_filter code[] = {
+        { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_NET_OFF + 12) }, // A = ip->saddr
+        { BPF_ALU | BPF_MOD | BPF_K,   0, 0, shards },                                  // A %= N
+        { BPF_RET | BPF_A,             0, 0, 0 },
+    };
+    sock_fprog prog{};
+    prog.len    = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    return ::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+}
+
+static void pin_to_cpu(std::thread& th, int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = ::pthread_setaffinity_np(th.native_handle(), sizeof(set), &set);
+    if (rc != 0) std::fprintf(stderr, "[WARN] pin to cpu %d failed: %s\n", cpu, std::strerror(rc));
+}
+
+// 샤드 워커: 소켓 하나만 읽고 자기 통계만 갱신
+static void shard_loop(Shard& sh) {
+    OutBuf out(STDOUT_FILENO);
+    OutBuf err(STDERR_FILENO);
 
-    while (true) {
+    uint64_t rx = 0, valid = 0, malformed = 0;
+
+    while (!g_stop.load(std::memory_order_relaxed)) {
         uint8_t buf[2048];
         sockaddr_in src{};
         socklen_t slen = sizeof(src);
 
-        ssize_t n = ::recvfrom(fd, buf, sizeof(buf), 0,
+        // 쌓인 로그가 있으면 논블로킹으로 받아보고, 더 받을 게 없을 때 한 번에 출력
+        int flags = (out.pending() || err.pending()) ? MSG_DONTWAIT : 0;
+        ssize_t n = ::recvfrom(sh.fd, buf, sizeof(buf), flags,
                                reinterpret_cast<sockaddr*>(&src), &slen);
         if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                out.flush();
+                err.flush();
+                continue;
+            }
+            if (errno == EINTR) continue;
+            if (g_stop.load()) break;
             perror("recvfrom");
             continue;
         }
+        if (n == 0 && g_stop.load()) break;   // stop_shards()의 shutdown
 
-        char src_ip[INET_ADDRSTRLEN]{};
-        ::inet_ntop(AF_INET, &src.sin_addr, src_ip, sizeof(src_ip));
-        uint16_t src_port = ntohs(src.sin_port);
+        ParseStatus st;
+        if (sh.quiet) {
+            // quiet 모드(벤치/대량 트래픽): 파싱과 통계만
+            CtrlMessage msg{};
+            st = parse_ctrl_packet(buf, static_cast<size_t>(n), msg);
+        } else {
+            char src_ip[INET_ADDRSTRLEN]{};
+            ::inet_ntop(AF_INET, &src.sin_addr, src_ip, sizeof(src_ip));
+            st = handle_packet(buf, static_cast<size_t>(n), src_ip, ntohs(src.sin_port), out, err);
+        }
+        rx++;
+        if (st == ParseStatus::Ok) valid++; else malformed++;
 
-        if (n < 5) {
-            std::cerr << "drop: too short (" << n << "B) from "
-                      << src_ip << ":" << src_port << "\n";
-            continue;
+        // 공유 캐시라인이 아니므로 relaxed store로 충분
+        sh.stats.rx.store(rx, std::memory_order_relaxed);
+        sh.stats.valid.store(valid, std::memory_order_relaxed);
+        sh.stats.malformed.store(malformed, std::memory_order_relaxed);
+    }
+
+    out.flush();
+    err.flush();
+}
+
+// shards개 소켓을 같은 포트에 열고 워커 시작. port가 0이면 임의 포트를 잡아서 돌려줌
+static bool start_shards(Shard* shards, unsigned n, uint16_t& port, Steer steer, bool quiet) {
+    bool reuseport = n > 1;
+    unsigned ncpu = std::thread::hardware_concurrency();
+    if (ncpu == 0) ncpu = 1;
+
+    for (unsigned i = 0; i < n; i++) {
+        shards[i].fd = open_shard_socket(port, reuseport);
+        if (shards[i].fd < 0) {
+            perror("socket/bind");
+            return false;
+        }
+        if (port == 0) {
+            sockaddr_in a{};
+            socklen_t alen = sizeof(a);
+            ::getsockname(shards[i].fd, reinterpret_cast<sockaddr*>(&a), &alen);
+            port = ntohs(a.sin_port);
         }
+        shards[i].cpu   = static_cast<int>(i % ncpu);
+        shards[i].quiet = quiet;
+    }
 
-        try {
-            CtrlMessage msg = parse_ctrl_packet(buf, static_cast<size_t>(n));
-
-            std::string gear_str =
-                (msg.gear == 0) ? "FWD" :
-                (msg.gear == 1) ? "BWD" :
-                ("UNKNOWN(" + std::to_string(msg.gear) + ")");
-
-            std::cout << "from " << src_ip << ":" << src_port
-                      << " | cmd=0x" << std::hex << (int)msg.cmd << std::dec
-                      << " steering=" << msg.steering_deg
-                      << " gear=" << gear_str
-                      << " speed=" << (int)msg.speed
-                      << "\n";
-        } catch (const std::exception& e) {
-            std::cerr << "parse error from " << src_ip << ":" << src_port
-                      << " : " << e.what() << "\n";
+    if (steer == Steer::SrcIp && n > 1 && attach_src_steering(shards[0].fd, n) != 0) {
+        perror("SO_ATTACH_REUSEPORT_CBPF (falling back to hash)");
+    }
+
+    for (unsigned i = 0; i < n; i++) {
+        Shard& sh = shards[i];
+        sh.thread = std::thread([&sh] { shard_loop(sh); });
+        if (n > 1) pin_to_cpu(sh.thread, sh.cpu);
+    }
+    return true;
+}
+
+static void stop_shards(Shard* shards, unsigned n) {
+    g_stop.store(true);
+    // 블로킹된 recvfrom을 깨움
+    for (unsigned i = 0; i < n; i++) {
+        if (shards[i].fd >= 0) ::shutdown(shards[i].fd, SHUT_RDWR);
+    }
+    for (unsigned i = 0; i < n; i++) {
+        if (shards[i].thread.joinable()) shards[i].thread.join();
+        if (shards[i].fd >= 0) ::close(shards[i].fd);
+        shards[i].fd = -1;
+    }
+}
+
+static void print_shard_stats(const Shard* shards, unsigned n, uint64_t* prev, double sec) {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t rx = shards[i].stats.rx.load(std::memory_order_relaxed);
+        std::printf("[shard %u cpu %d] rx=%llu (%.0f pkt/s) valid=%llu malformed=%llu\n",
+                    i, shards[i].cpu,
+                    static_cast<unsigned long long>(rx), (rx - prev[i]) / sec,
+                    static_cast<unsigned long long>(shards[i].stats.valid.load(std::memory_order_relaxed)),
+                    static_cast<unsigned long long>(shards[i].stats.malformed.load(std::memory_order_relaxed)));
+        total += rx - prev[i];
+        prev[i] = rx;
+    }
+    std::printf("[total] %.0f pkt/s\n", total / sec);
+    std::fflush(stdout);
+}
+
+// ---- 벤치마크 모드 ----
+// 정상/잘못된 패킷을 handle_packet()에 반복 투입해서 초당 처리량 측정 (출력은 /dev/null).
+// -DGATEWAY_COUNT_ALLOCS 로 빌드하면 (make check) 전역 할당자와 예외 객체 생성을 가로채서
+// 패킷당 할당/throw 횟수를 세고, 하나라도 있으면 실패로 끝냄
+#ifdef GATEWAY_COUNT_ALLOCS
+static size_t g_alloc_count = 0;
+static size_t g_throw_count = 0;
+
+void* operator new(size_t n) {
+    ++g_alloc_count;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// throw 마다 런타임이 예외 객체를 여기서 할당함 (catch 되든 안 되든)
+extern "C" void* __cxa_allocate_exception(size_t n) noexcept {
+    using Fn = void* (*)(size_t);
+    static Fn real = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, "__cxa_allocate_exception"));
+    ++g_throw_count;
+    return real(n);
+}
+#endif
+
+static int run_bench(unsigned long packets) {
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        perror("open(/dev/null)");
+        return 1;
+    }
+
+    static OutBuf out(null_fd);
+    static OutBuf err(null_fd);
+
+    const uint8_t valid[kCtrlPacketLen]     = { 0x10, 0xFF, 0xE2, 0x01, 0x50 };
+    const uint8_t bad_gear[kCtrlPacketLen]  = { 0x10, 0x00, 0x0A, 0x07, 0x50 };
+    const uint8_t malformed[2]              = { 0x10, 0x00 };
+
+    struct Case { const char* name; const uint8_t* buf; size_t len; };
+    const Case cases[] = {
+        { "valid",       valid,     sizeof(valid) },
+        { "unknown gear", bad_gear, sizeof(bad_gear) },
+        { "malformed",   malformed, sizeof(malformed) },
+    };
+
+    int rc = 0;
+    for (const Case& c : cases) {
+#ifdef GATEWAY_COUNT_ALLOCS
+        size_t allocs_before = g_alloc_count;
+        size_t throws_before = g_throw_count;
+#endif
+        auto t0 = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < packets; i++) {
+            handle_packet(c.buf, c.len, "192.168.0.10", 40000, out, err);
         }
+        out.flush();
+        err.flush();
+        auto t1 = std::chrono::steady_clock::now();
+
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::printf("%-13s %lu packets in %.3f s -> %.0f pkt/s\n",
+                    c.name, packets, sec, sec > 0 ? packets / sec : 0.0);
+#ifdef GATEWAY_COUNT_ALLOCS
+        size_t allocs = g_alloc_count - allocs_before;
+        size_t throws = g_throw_count - throws_before;
+        std::printf("%-13s allocations: %zu throws: %zu\n", c.name, allocs, throws);
+        if (allocs != 0 || throws != 0) rc = 1;
+#endif
     }
 
-    ::close(fd);
+    ::close(null_fd);
+    return rc;
+}
+
+// 샤드 수 1..max 에 대해 루프백 flood 수신 처리량 측정
+static int run_shard_bench(unsigned max_shards, unsigned flows, double seconds) {
+    const uint8_t valid[kCtrlPacketLen] = { 0x10, 0xFF, 0xE2, 0x01, 0x50 };
+
+    for (unsigned n = 1; n <= max_shards; n++) {
+        g_stop.store(false);
+        std::unique_ptr<Shard[]> shards(new Shard[n]);
+        uint16_t port = 0;
+        if (!start_shards(shards.get(), n, port, Steer::Hash, true)) {
+            stop_shards(shards.get(), n);
+            return 1;
+        }
+
+        // 흐름마다 소켓 하나 (출발지 포트가 달라서 해시로 샤드에 분산됨)
+        std::atomic<bool> send_stop{false};
+        std::vector<std::thread> senders;
+        unsigned nsenders = std::min(flows, std::max(1u, std::thread::hardware_concurrency()));
+        for (unsigned t = 0; t < nsenders; t++) {
+            senders.emplace_back([&, t] {
+                std::vector<int> fds;
+                for (unsigned f = t; f < flows; f += nsenders) {
+                    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+                    sockaddr_in dst{};
+                    dst.sin_family = AF_INET;
+                    dst.sin_port   = htons(port);
+                    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                    ::connect(fd, reinterpret_cast<sockaddr*>(&dst), sizeof(dst));
+                    fds.push_back(fd);
+                }
+                while (!send_stop.load(std::memory_order_relaxed)) {
+                    for (int fd : fds) ::send(fd, valid, sizeof(valid), MSG_DONTWAIT);
+                }
+                for (int fd : fds) ::close(fd);
+            });
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        send_stop.store(true);
+        for (auto& th : senders) th.join();
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        uint64_t total = 0;
+        std::printf("shards=%u flows=%u:", n, flows);
+        for (unsigned i = 0; i < n; i++) {
+            uint64_t rx = shards[i].stats.rx.load();
+            total += rx;
+            std::printf(" %llu", static_cast<unsigned long long>(rx));
+        }
+        std::printf(" -> %.0f pkt/s\n", total / sec);
+        std::fflush(stdout);
+
+        stop_shards(shards.get(), n);
+    }
     return 0;
 }
 
+static bool parse_u16(const char* s, uint16_t& out) noexcept {
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0' || v < 0 || v > 65535) return false;
+    out = static_cast<uint16_t>(v);
+    return true;
+}
+
+static void usage(const char* prog) {
+    std::fprintf(stderr,
+                 "Usage: %s [port] [--shards N] [--steer hash|src] [--quiet]\n"
+                 "       %s --bench [packets]\n"
+                 "       %s --bench-shards N [flows] [seconds]\n",
+                 prog, prog, prog);
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::strcmp(argv[1], "--bench") == 0) {
+        unsigned long packets = (argc >= 3) ? std::strtoul(argv[2], nullptr, 10) : 5000000ul;
+        return run_bench(packets ? packets : 1);
+    }
+    if (argc >= 3 && std::strcmp(argv[1], "--bench-shards") == 0) {
+        unsigned max_shards = static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10));
+        unsigned flows      = (argc >= 4) ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 64;
+        double   seconds    = (argc >= 5) ? std::strtod(argv[4], nullptr) : 2.0;
+        if (max_shards == 0 || flows == 0 || seconds <= 0) {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_shard_bench(max_shards, flows, seconds);
+    }
+
+    uint16_t port = 9000;
+    unsigned nshards = 1;
+    Steer steer = Steer::Hash;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            nshards = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--steer") == 0 && i + 1 < argc) {
+            const char* v = argv[++i];
+            if (std::strcmp(v, "src") == 0)       steer = Steer::SrcIp;
+            else if (std::strcmp(v, "hash") == 0) steer = Steer::Hash;
+            else { usage(argv[0]); return 1; }
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (!parse_u16(argv[i], port)) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nshards == 0 || nshards > 256) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    std::unique_ptr<Shard[]> shards(new Shard[nshards]);
+    if (!start_shards(shards.get(), nshards, port, steer, quiet)) {
+        stop_shards(shards.get(), nshards);
+        return 1;
+    }
+
+    std::printf("UDP listening on 0.0.0.0:%u (%u shard%s, steer=%s)\n",
+                static_cast<unsigned>(port), nshards, nshards > 1 ? "s" : "",
+                steer == Steer::SrcIp ? "src" : "hash");
+    std::fflush(stdout);
+
+    // 샤드가 여러 개이거나 quiet 모드면 주기적으로 샤드별 통계 출력
+    std::unique_ptr<uint64_t[]> prev(new uint64_t[nshards]());
+    auto last = std::chrono::steady_clock::now();
+    while (!g_stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = std::chrono::steady_clock::now();
+        double sec = std::chrono::duration<double>(now - last).count();
+        if (sec >= 5.0) {
+            if (nshards > 1 || quiet) print_shard_stats(shards.get(), nshards, prev.get(), sec);
+            last = now;
+        }
+    }
+
+    stop_shards(shards.get(), nshards);
+    return 0;
+}